@@ -0,0 +1,21 @@
+//
+// Created by mahie on 01/03/2024.
+//
+
+#ifndef OPENGLTEMPL_ATTRIBUTE_H
+#define OPENGLTEMPL_ATTRIBUTE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <utility>
+
+struct Attribute {
+    GLuint attrib_index;
+    size_t offset;
+    std::pair<GLenum, GLint> type_size;
+    // Integer types map to [0, 1] (unsigned) or [-1, 1] (signed) instead of their plain value
+    GLboolean normalized{GL_FALSE};
+};
+
+#endif // OPENGLTEMPL_ATTRIBUTE_H
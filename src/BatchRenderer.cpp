@@ -0,0 +1,53 @@
+#include "BatchRenderer.h"
+
+#include <span>
+
+const std::string BatchRenderer::glsl = R"(
+    struct DrawData {
+        mat4 model;
+        uint material;
+    };
+    layout (std430, binding = 0) readonly buffer Draws {
+        DrawData draws[];
+    };
+
+    DrawData draw_data() {
+        return draws[gl_BaseInstance + gl_InstanceID];
+    }
+)";
+
+void BatchRenderer::add(const MeshRange &mesh, const glm::mat4 &model,
+                        GLuint material) {
+  if (!mesh.valid()) {
+    return;
+  }
+  commands.push_back({static_cast<GLuint>(mesh.count), 1, mesh.first_index,
+                      mesh.base_vertex, static_cast<GLuint>(draws.size())});
+  draws.push_back({model, material, {}});
+}
+
+void BatchRenderer::submit(GLenum mode) {
+  if (commands.empty()) {
+    return;
+  }
+  StreamBuffer::Slice draw_slice =
+      stream.storage(std::span<const DrawData>{draws});
+  StreamBuffer::Slice command_slice = stream.write(
+      std::span<const DrawElementsIndirectCommand>{commands}, sizeof(GLuint));
+  if (draw_slice.valid() && command_slice.valid()) {
+    stream.bind_storage(draw_binding, draw_slice);
+    geometry.bind();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream);
+    glMultiDrawElementsIndirect(
+        mode, GL_UNSIGNED_INT,
+        reinterpret_cast<const void *>(command_slice.offset),
+        static_cast<GLsizei>(commands.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  }
+  clear();
+}
+
+void BatchRenderer::clear() {
+  commands.clear();
+  draws.clear();
+}
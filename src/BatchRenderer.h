@@ -0,0 +1,64 @@
+#ifndef OPENGLTEMPL_BATCHRENDERER_H
+#define OPENGLTEMPL_BATCHRENDERER_H
+
+#include <glad/glad.h>
+
+#include "GeometryArena.h"
+#include "StreamBuffer.h"
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// What glMultiDrawElementsIndirect reads for every draw
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+
+// std430 mirror of the shader's DrawData
+struct DrawData {
+  glm::mat4 model;
+  GLuint material;
+  GLuint padding[3];
+};
+
+// Collects the meshes of one GeometryArena into an indirect command buffer
+// and submits the whole pass with a single glMultiDrawElementsIndirect.
+// Commands and per-draw data are streamed every frame, each command's base
+// instance points at its DrawData so the vertex shader finds it with
+// gl_BaseInstance whatever order the commands end up in.
+class BatchRenderer {
+private:
+  const GeometryArena &geometry;
+  StreamBuffer &stream;
+  std::vector<DrawElementsIndirectCommand> commands;
+  std::vector<DrawData> draws;
+
+public:
+  static constexpr GLuint draw_binding = 0;
+
+  BatchRenderer(const GeometryArena &geometry_arena,
+                StreamBuffer &stream_buffer)
+      : geometry(geometry_arena), stream(stream_buffer) {}
+
+  // material is whatever the shader makes of it, a TextureArray layer say
+  void add(const MeshRange &mesh, const glm::mat4 &model, GLuint material = 0);
+
+  // Streams the queued draws and issues them, then clears the queue. The
+  // program has to be in use and between stream's begin and end_frame().
+  void submit(GLenum mode = GL_TRIANGLES);
+  void clear();
+
+  size_t size() const { return commands.size(); }
+
+  // Paste after #version in the vertex shader, draw_data() is this draw's
+  // entry.
+  static const std::string glsl;
+};
+
+#endif // OPENGLTEMPL_BATCHRENDERER_H
@@ -0,0 +1,500 @@
+#include "BlockCompression.h"
+
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OPENGLTEMPL_SSE2
+#endif
+
+namespace {
+
+// 4x4 texels, one row of 16 per channel so the kernels can load 4 at a time
+struct Block {
+  alignas(16) float c[4][16];
+};
+
+void fetch_block(const unsigned char *pixels, int width, int height,
+                 int channels, int bx, int by, Block &block) {
+  for (int i = 0; i < 16; ++i) {
+    int x = std::min(bx * 4 + i % 4, width - 1);
+    int y = std::min(by * 4 + i / 4, height - 1);
+    const unsigned char *p =
+        pixels + (static_cast<size_t>(y) * width + x) * channels;
+    switch (channels) {
+    case 1:
+      block.c[0][i] = block.c[1][i] = block.c[2][i] = p[0];
+      block.c[3][i] = 255;
+      break;
+    case 2:
+      block.c[0][i] = p[0];
+      block.c[1][i] = p[1];
+      block.c[2][i] = 0;
+      block.c[3][i] = 255;
+      break;
+    default:
+      block.c[0][i] = p[0];
+      block.c[1][i] = p[1];
+      block.c[2][i] = p[2];
+      block.c[3][i] = channels == 4 ? p[3] : 255;
+      break;
+    }
+  }
+}
+
+// BC6H works on half float bit patterns, which grow roughly logarithmically
+// with the value. They are scaled to the 0..255 range the shared kernels use.
+constexpr float half_max = 0x7BFF;
+constexpr float half_scale = 255.0f / half_max;
+
+void fetch_block(const float *pixels, int width, int height, int bx, int by,
+                 Block &block) {
+  for (int i = 0; i < 16; ++i) {
+    int x = std::min(bx * 4 + i % 4, width - 1);
+    int y = std::min(by * 4 + i / 4, height - 1);
+    const float *p = pixels + (static_cast<size_t>(y) * width + x) * 3;
+    for (int c = 0; c < 3; ++c) {
+      block.c[c][i] = float_to_half(p[c]) * half_scale;
+    }
+    block.c[3][i] = 255;
+  }
+}
+
+// Picks the closest palette entry for each texel, returns the summed error.
+// chans points at the first channel used, count channels follow it.
+float nearest(const float (*chans)[16], int count, const float (*palette)[4],
+              int entries, uint8_t indices[16]) {
+  float error{0};
+#ifdef OPENGLTEMPL_SSE2
+  for (int p = 0; p < 16; p += 4) {
+    __m128 best = _mm_set1_ps(FLT_MAX);
+    __m128i best_i = _mm_setzero_si128();
+    for (int e = 0; e < entries; ++e) {
+      __m128 dist = _mm_setzero_ps();
+      for (int c = 0; c < count; ++c) {
+        __m128 d =
+            _mm_sub_ps(_mm_load_ps(&chans[c][p]), _mm_set1_ps(palette[e][c]));
+        dist = _mm_add_ps(dist, _mm_mul_ps(d, d));
+      }
+      __m128i closer = _mm_castps_si128(_mm_cmplt_ps(dist, best));
+      best = _mm_min_ps(dist, best);
+      best_i = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(e)),
+                            _mm_andnot_si128(closer, best_i));
+    }
+    alignas(16) int32_t lanes_i[4];
+    alignas(16) float lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes_i), best_i);
+    _mm_store_ps(lanes, best);
+    for (int k = 0; k < 4; ++k) {
+      indices[p + k] = static_cast<uint8_t>(lanes_i[k]);
+      error += lanes[k];
+    }
+  }
+#else
+  for (int p = 0; p < 16; ++p) {
+    float best = FLT_MAX;
+    for (int e = 0; e < entries; ++e) {
+      float dist{0};
+      for (int c = 0; c < count; ++c) {
+        float d = chans[c][p] - palette[e][c];
+        dist += d * d;
+      }
+      if (dist < best) {
+        best = dist;
+        indices[p] = static_cast<uint8_t>(e);
+      }
+    }
+    error += best;
+  }
+#endif
+  return error;
+}
+
+// Endpoints along the principal axis of the block's colours.
+void principal_endpoints(const Block &block, int count, float lo[4],
+                         float hi[4]) {
+  float mean[4]{};
+  for (int c = 0; c < count; ++c) {
+    for (int i = 0; i < 16; ++i) {
+      mean[c] += block.c[c][i];
+    }
+    mean[c] /= 16;
+  }
+  float cov[4][4]{};
+  for (int i = 0; i < 16; ++i) {
+    for (int a = 0; a < count; ++a) {
+      for (int b = 0; b < count; ++b) {
+        cov[a][b] += (block.c[a][i] - mean[a]) * (block.c[b][i] - mean[b]);
+      }
+    }
+  }
+  float axis[4]{1, 1, 1, 1};
+  for (int iter = 0; iter < 8; ++iter) {
+    float next[4]{};
+    float len{0};
+    for (int a = 0; a < count; ++a) {
+      for (int b = 0; b < count; ++b) {
+        next[a] += cov[a][b] * axis[b];
+      }
+      len += next[a] * next[a];
+    }
+    if (len < 1e-6f) {
+      break; // flat block
+    }
+    len = std::sqrt(len);
+    for (int a = 0; a < count; ++a) {
+      axis[a] = next[a] / len;
+    }
+  }
+  float t_min = FLT_MAX, t_max = -FLT_MAX;
+  for (int i = 0; i < 16; ++i) {
+    float t{0};
+    for (int c = 0; c < count; ++c) {
+      t += (block.c[c][i] - mean[c]) * axis[c];
+    }
+    t_min = std::min(t_min, t);
+    t_max = std::max(t_max, t);
+  }
+  for (int c = 0; c < count; ++c) {
+    lo[c] = std::clamp(mean[c] + t_min * axis[c], 0.0f, 255.0f);
+    hi[c] = std::clamp(mean[c] + t_max * axis[c], 0.0f, 255.0f);
+  }
+}
+
+uint16_t pack565(const float c[4]) {
+  auto r = static_cast<uint16_t>(std::lround(c[0] * 31 / 255));
+  auto g = static_cast<uint16_t>(std::lround(c[1] * 63 / 255));
+  auto b = static_cast<uint16_t>(std::lround(c[2] * 31 / 255));
+  return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+void unpack565(uint16_t v, float c[4]) {
+  int r = v >> 11 & 31, g = v >> 5 & 63, b = v & 31;
+  c[0] = static_cast<float>(r << 3 | r >> 2);
+  c[1] = static_cast<float>(g << 2 | g >> 4);
+  c[2] = static_cast<float>(b << 3 | b >> 2);
+  c[3] = 255;
+}
+
+void encode_bc1(const Block &block, unsigned char *out) {
+  float lo[4], hi[4];
+  principal_endpoints(block, 3, lo, hi);
+  uint16_t c0 = pack565(hi), c1 = pack565(lo);
+  if (c0 < c1) {
+    std::swap(c0, c1);
+  }
+  uint8_t indices[16]{};
+  if (c0 != c1) {
+    float palette[4][4];
+    unpack565(c0, palette[0]);
+    unpack565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    nearest(block.c, 3, palette, 4, indices);
+  }
+  uint32_t bits{0};
+  for (int i = 0; i < 16; ++i) {
+    bits |= static_cast<uint32_t>(indices[i]) << (2 * i);
+  }
+  out[0] = c0 & 0xFF;
+  out[1] = c0 >> 8;
+  out[2] = c1 & 0xFF;
+  out[3] = c1 >> 8;
+  for (int i = 0; i < 4; ++i) {
+    out[4 + i] = bits >> (8 * i) & 0xFF;
+  }
+}
+
+void encode_bc4(const Block &block, int channel, unsigned char *out) {
+  const float *values = block.c[channel];
+  auto a0 = static_cast<int>(std::lround(*std::max_element(values, values + 16)));
+  auto a1 = static_cast<int>(std::lround(*std::min_element(values, values + 16)));
+  uint8_t indices[16]{};
+  if (a0 != a1) {
+    // a0 > a1 selects the eight value mode
+    float palette[8][4];
+    palette[0][0] = static_cast<float>(a0);
+    palette[1][0] = static_cast<float>(a1);
+    for (int i = 1; i < 7; ++i) {
+      palette[i + 1][0] = static_cast<float>((7 - i) * a0 + i * a1) / 7;
+    }
+    nearest(&block.c[channel], 1, palette, 8, indices);
+  }
+  out[0] = static_cast<unsigned char>(a0);
+  out[1] = static_cast<unsigned char>(a1);
+  uint64_t bits{0};
+  for (int i = 0; i < 16; ++i) {
+    bits |= static_cast<uint64_t>(indices[i]) << (3 * i);
+  }
+  for (int i = 0; i < 6; ++i) {
+    out[2 + i] = bits >> (8 * i) & 0xFF;
+  }
+}
+
+class BitWriter {
+private:
+  unsigned char *out;
+  int pos{0};
+
+public:
+  explicit BitWriter(unsigned char *dst) : out(dst) {
+    std::fill(out, out + 16, 0);
+  }
+  void write(uint32_t value, int bits) {
+    for (int i = 0; i < bits; ++i, ++pos) {
+      out[pos / 8] |= ((value >> i) & 1) << (pos % 8);
+    }
+  }
+};
+
+// BC7 mode 6: a single RGBA subset, 7 bit endpoints plus a p-bit each and
+// 4 bit indices. Enough for everything we ship without a partition search.
+void encode_bc7(const Block &block, unsigned char *out) {
+  static constexpr int weights[16]{0,  4,  9,  13, 17, 21, 26, 30,
+                                   34, 38, 43, 47, 51, 55, 60, 64};
+  float lo[4], hi[4];
+  principal_endpoints(block, 4, lo, hi);
+
+  int v[2][4], p[2];
+  const float *ends[2]{lo, hi};
+  for (int e = 0; e < 2; ++e) {
+    float best = FLT_MAX;
+    for (int pbit = 0; pbit < 2; ++pbit) {
+      float error{0};
+      int q[4];
+      for (int c = 0; c < 4; ++c) {
+        q[c] = std::clamp(static_cast<int>(std::lround((ends[e][c] - pbit) / 2)),
+                          0, 127);
+        float d = static_cast<float>(q[c] << 1 | pbit) - ends[e][c];
+        error += d * d;
+      }
+      if (error < best) {
+        best = error;
+        p[e] = pbit;
+        std::copy(q, q + 4, v[e]);
+      }
+    }
+  }
+
+  float palette[16][4];
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 4; ++c) {
+      int e0 = v[0][c] << 1 | p[0], e1 = v[1][c] << 1 | p[1];
+      palette[i][c] = static_cast<float>(
+          ((64 - weights[i]) * e0 + weights[i] * e1 + 32) >> 6);
+    }
+  }
+  uint8_t indices[16];
+  nearest(block.c, 4, palette, 16, indices);
+
+  // The anchor index drops its top bit, so it has to be below 8
+  if (indices[0] & 8) {
+    std::swap(v[0], v[1]);
+    std::swap(p[0], p[1]);
+    for (uint8_t &index : indices) {
+      index = 15 - index;
+    }
+  }
+
+  BitWriter bits{out};
+  bits.write(1 << 6, 7);
+  for (int c = 0; c < 4; ++c) {
+    bits.write(v[0][c], 7);
+    bits.write(v[1][c], 7);
+  }
+  bits.write(p[0], 1);
+  bits.write(p[1], 1);
+  bits.write(indices[0], 3);
+  for (int i = 1; i < 16; ++i) {
+    bits.write(indices[i], 4);
+  }
+}
+
+// BC6H mode 11: one region, 10 bit endpoints, no transform and 4 bit
+// indices. Endpoints are unquantised to x * 64 + 32, interpolated and scaled
+// by 31/64 to land on a half float.
+void encode_bc6h(const Block &block, unsigned char *out) {
+  static constexpr int weights[16]{0,  4,  9,  13, 17, 21, 26, 30,
+                                   34, 38, 43, 47, 51, 55, 60, 64};
+  auto unquantize = [](int x) {
+    return x == 0 ? 0 : x == 1023 ? 0xFFFF : x * 64 + 32;
+  };
+  float lo[4], hi[4];
+  principal_endpoints(block, 3, lo, hi);
+  int v[2][3];
+  const float *ends[2]{lo, hi};
+  for (int e = 0; e < 2; ++e) {
+    for (int c = 0; c < 3; ++c) {
+      float half = ends[e][c] / half_scale;
+      v[e][c] = std::clamp(
+          static_cast<int>(std::lround((half * 64 / 31 - 32) / 64)), 0, 1023);
+    }
+  }
+
+  float palette[16][4];
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      int a = unquantize(v[0][c]), b = unquantize(v[1][c]);
+      int q = (a * (64 - weights[i]) + b * weights[i] + 32) >> 6;
+      palette[i][c] = static_cast<float>((q * 31) >> 6) * half_scale;
+    }
+  }
+  uint8_t indices[16];
+  nearest(block.c, 3, palette, 16, indices);
+
+  if (indices[0] & 8) {
+    std::swap(v[0], v[1]);
+    for (uint8_t &index : indices) {
+      index = 15 - index;
+    }
+  }
+
+  BitWriter bits{out};
+  bits.write(0x03, 5);
+  for (int e = 0; e < 2; ++e) {
+    for (int c = 0; c < 3; ++c) {
+      bits.write(v[e][c], 10);
+    }
+  }
+  bits.write(indices[0], 3);
+  for (int i = 1; i < 16; ++i) {
+    bits.write(indices[i], 4);
+  }
+}
+
+void encode_block(const Block &block, BlockFormat format, unsigned char *out) {
+  switch (format) {
+  case BlockFormat::BC1:
+    encode_bc1(block, out);
+    break;
+  case BlockFormat::BC3:
+    encode_bc4(block, 3, out);
+    encode_bc1(block, out + 8);
+    break;
+  case BlockFormat::BC4:
+    encode_bc4(block, 0, out);
+    break;
+  case BlockFormat::BC5:
+    encode_bc4(block, 0, out);
+    encode_bc4(block, 1, out + 8);
+    break;
+  case BlockFormat::BC6H:
+    encode_bc6h(block, out);
+    break;
+  case BlockFormat::BC7:
+    encode_bc7(block, out);
+    break;
+  }
+}
+
+template <typename F>
+std::vector<unsigned char> encode_level(int width, int height,
+                                        BlockFormat format, ThreadPool *pool,
+                                        F &&fetch) {
+  int blocks_x = (width + 3) / 4;
+  int blocks_y = (height + 3) / 4;
+  size_t bytes = block_bytes(format);
+  std::vector<unsigned char> out(static_cast<size_t>(blocks_x) * blocks_y *
+                                 bytes);
+
+  auto encode_rows = [&](int first, int last) {
+    Block block;
+    for (int by = first; by < last; ++by) {
+      for (int bx = 0; bx < blocks_x; ++bx) {
+        fetch(bx, by, block);
+        encode_block(block, format,
+                     out.data() + (static_cast<size_t>(by) * blocks_x + bx) *
+                                      bytes);
+      }
+    }
+  };
+
+  if (!pool) {
+    encode_rows(0, blocks_y);
+    return out;
+  }
+  constexpr int rows_per_task = 4;
+  pool->parallel_for((blocks_y + rows_per_task - 1) / rows_per_task,
+                     [&](size_t task) {
+                       int first = static_cast<int>(task) * rows_per_task;
+                       encode_rows(first,
+                                   std::min(first + rows_per_task, blocks_y));
+                     });
+  return out;
+}
+
+} // namespace
+
+std::vector<unsigned char> compress_level(const unsigned char *pixels,
+                                          int width, int height, int channels,
+                                          BlockFormat format,
+                                          ThreadPool *pool) {
+  return encode_level(width, height, format, pool,
+                      [&](int bx, int by, Block &block) {
+                        fetch_block(pixels, width, height, channels, bx, by,
+                                    block);
+                        if (format == BlockFormat::BC6H) {
+                          // 8 bit input is 0..1 in half floats
+                          for (int c = 0; c < 3; ++c) {
+                            for (float &v : block.c[c]) {
+                              v = float_to_half(v / 255) * half_scale;
+                            }
+                          }
+                        }
+                      });
+}
+
+CompressedImage compress(const Image &image, BlockFormat format,
+                         ThreadPool *pool) {
+  CompressedImage compressed{format, image.width, image.height, {}};
+  if (image.empty()) {
+    return compressed;
+  }
+  for (size_t level = 0; level < image.level_count(); ++level) {
+    compressed.levels.push_back(compress_level(
+        image.level(level).data(), image.level_width(level),
+        image.level_height(level), image.channels, format, pool));
+  }
+  return compressed;
+}
+
+CompressedImage compress(const HdrImage &image, ThreadPool *pool) {
+  CompressedImage compressed{BlockFormat::BC6H, image.width, image.height, {}};
+  for (size_t level = 0; level < image.level_count() && !image.empty();
+       ++level) {
+    int width = image.level_width(level), height = image.level_height(level);
+    const float *pixels = image.level(level).data();
+    compressed.levels.push_back(encode_level(
+        width, height, BlockFormat::BC6H, pool,
+        [&](int bx, int by, Block &block) {
+          fetch_block(pixels, width, height, bx, by, block);
+        }));
+  }
+  return compressed;
+}
+
+namespace {
+std::atomic<bool> s3tc{true};
+}
+
+bool query_s3tc_support() {
+  GLint count{0};
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  bool found{false};
+  for (GLint i = 0; i < count && !found; ++i) {
+    auto name = reinterpret_cast<const char *>(
+        glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+    found = name && std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0;
+  }
+  s3tc = found;
+  return found;
+}
+
+bool s3tc_supported() { return s3tc; }
@@ -0,0 +1,80 @@
+#ifndef OPENGLTEMPL_BLOCKCOMPRESSION_H
+#define OPENGLTEMPL_BLOCKCOMPRESSION_H
+
+#include <glad/glad.h>
+
+#include "HdrImage.h"
+#include "Image.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// S3TC isn't core, glad was generated without extensions and drivers aren't
+// required to expose it, see s3tc_supported()
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+enum class BlockFormat { BC1, BC3, BC4, BC5, BC6H, BC7 };
+
+// Every level of a block compressed mip chain, level 0 first.
+struct CompressedImage {
+  BlockFormat format{};
+  int width{}, height{};
+  std::vector<std::vector<unsigned char>> levels;
+
+  bool empty() const { return levels.empty(); }
+  int level_width(size_t level) const { return std::max(1, width >> level); }
+  int level_height(size_t level) const { return std::max(1, height >> level); }
+};
+
+constexpr size_t block_bytes(BlockFormat format) {
+  return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+constexpr GLenum internal_format(BlockFormat format) {
+  switch (format) {
+  case BlockFormat::BC1:
+    return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  case BlockFormat::BC3:
+    return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  case BlockFormat::BC4:
+    return GL_COMPRESSED_RED_RGTC1;
+  case BlockFormat::BC5:
+    return GL_COMPRESSED_RG_RGTC2;
+  case BlockFormat::BC6H:
+    return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+  case BlockFormat::BC7:
+    return GL_COMPRESSED_RGBA_BPTC_UNORM;
+  }
+  return GL_NONE;
+}
+
+// Looks for GL_EXT_texture_compression_s3tc, on the GL thread. Formats are
+// picked on worker threads (and in tools without a context), which read the
+// answer through s3tc_supported(), true until queried.
+bool query_s3tc_support();
+bool s3tc_supported();
+
+// Encodes one level. Rows of blocks are spread over the pool when one is
+// given.
+std::vector<unsigned char> compress_level(const unsigned char *pixels,
+                                          int width, int height, int channels,
+                                          BlockFormat format,
+                                          ThreadPool *pool = nullptr);
+
+// Encodes every level the image carries, run generate_mips() first to get a
+// full chain.
+CompressedImage compress(const Image &image, BlockFormat format,
+                         ThreadPool *pool = nullptr);
+
+// BC6H (unsigned) for every level of an HDR image, same 8 bits a texel as
+// BC7 but keeps the full half float range.
+CompressedImage compress(const HdrImage &image, ThreadPool *pool = nullptr);
+
+#endif // OPENGLTEMPL_BLOCKCOMPRESSION_H
@@ -0,0 +1,31 @@
+#include "BufferArena.h"
+
+#include <iostream>
+
+BufferArena::BufferArena(uint32_t bytes, GLbitfield flags) : allocator(bytes) {
+  glCreateBuffers(1, &id_);
+  glNamedBufferStorage(id_, bytes, nullptr, flags);
+}
+
+BufferArena::~BufferArena() { glDeleteBuffers(1, &id_); }
+
+BufferArena::Range BufferArena::allocate(uint32_t size, uint32_t alignment) {
+  OffsetAllocator::Allocation allocation = allocator.allocate(size, alignment);
+  if (!allocation.valid()) {
+    std::cout << "ERROR::BUFFER_ARENA::OUT_OF_SPACE\n"
+              << size << " bytes, " << allocator.free_bytes() << " free"
+              << std::endl;
+    return {};
+  }
+  return {allocation, allocation.offset, size};
+}
+
+BufferArena::Range BufferArena::upload(std::span<const std::byte> data,
+                                       uint32_t alignment) {
+  Range range = allocate(static_cast<uint32_t>(data.size()), alignment);
+  if (range.valid() && !data.empty()) {
+    glNamedBufferSubData(id_, range.offset,
+                         static_cast<GLsizeiptr>(data.size()), data.data());
+  }
+  return range;
+}
@@ -0,0 +1,48 @@
+#ifndef OPENGLTEMPL_BUFFERARENA_H
+#define OPENGLTEMPL_BUFFERARENA_H
+
+#include <glad/glad.h>
+
+#include "OffsetAllocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// One immutable glNamedBufferStorage buffer carved up by an OffsetAllocator,
+// so many small buffers become ranges of a single GL name.
+class BufferArena {
+private:
+  GLuint id_{};
+  OffsetAllocator allocator;
+
+public:
+  struct Range {
+    OffsetAllocator::Allocation allocation;
+    uint32_t offset{}, size{};
+
+    bool valid() const { return allocation.valid(); }
+  };
+
+  // The default flags allow glNamedBufferSubData, which upload() relies on
+  explicit BufferArena(uint32_t bytes,
+                       GLbitfield flags = GL_DYNAMIC_STORAGE_BIT);
+  ~BufferArena();
+
+  BufferArena(const BufferArena &) = delete;
+  BufferArena &operator=(const BufferArena &) = delete;
+
+  // Invalid Range when the arena is too full or fragmented
+  Range allocate(uint32_t size, uint32_t alignment = 1);
+  Range upload(std::span<const std::byte> data, uint32_t alignment = 1);
+  void free(const Range &range) { allocator.free(range.allocation); }
+
+  uint32_t used_bytes() const {
+    return allocator.total_bytes() - allocator.free_bytes();
+  }
+  uint32_t capacity() const { return allocator.total_bytes(); }
+
+  operator GLuint() const { return id_; }
+};
+
+#endif // OPENGLTEMPL_BUFFERARENA_H
@@ -0,0 +1,179 @@
+#include "CullingPass.h"
+
+#include "BatchRenderer.h"
+#include "Frustum.h"
+
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+#include <iostream>
+
+namespace {
+const std::string cull_source = R"(
+    #version 460 core
+    layout (local_size_x = 64) in;
+
+    struct CullObject {
+        vec4 sphere;
+        uint count;
+        uint first_index;
+        int base_vertex;
+        uint draw;
+    };
+    struct Command {
+        uint count;
+        uint instance_count;
+        uint first_index;
+        int base_vertex;
+        uint base_instance;
+    };
+
+    layout (std430, binding = 1) readonly buffer Objects {
+        CullObject objects[];
+    };
+    layout (std430, binding = 2) writeonly buffer Commands {
+        Command commands[];
+    };
+    layout (std430, binding = 3) buffer Count {
+        uint draw_count;
+    };
+
+    uniform uint object_count;
+    uniform vec4 planes[6];
+    // hiz_levels 0 turns the occlusion test off
+    uniform sampler2D hiz;
+    uniform int hiz_levels;
+    uniform mat4 hiz_view_proj;
+
+    bool occluded(vec4 sphere) {
+        vec2 ndc_min = vec2(1.0);
+        vec2 ndc_max = vec2(-1.0);
+        float nearest = 1.0;
+        for (int i = 0; i < 8; ++i) {
+            vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0,
+                                                       (i & 2) != 0 ? 1.0 : -1.0,
+                                                       (i & 4) != 0 ? 1.0 : -1.0);
+            vec4 clip = hiz_view_proj * vec4(corner, 1.0);
+            if (clip.w <= 0.0) {
+                return false; // straddles the camera, no sensible rect
+            }
+            vec3 ndc = clip.xyz / clip.w;
+            ndc_min = min(ndc_min, ndc.xy);
+            ndc_max = max(ndc_max, ndc.xy);
+            nearest = min(nearest, ndc.z * 0.5 + 0.5);
+        }
+        vec2 uv_min = clamp(ndc_min * 0.5 + 0.5, 0.0, 1.0);
+        vec2 uv_max = clamp(ndc_max * 0.5 + 0.5, 0.0, 1.0);
+        vec2 extent = (uv_max - uv_min) * vec2(textureSize(hiz, 0));
+        int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, hiz_levels - 1);
+        ivec2 size = textureSize(hiz, level);
+        ivec2 lo = ivec2(uv_min * vec2(size));
+        ivec2 hi = min(ivec2(uv_max * vec2(size)), size - 1);
+        float farthest = 0.0;
+        for (int y = lo.y; y <= hi.y; ++y) {
+            for (int x = lo.x; x <= hi.x; ++x) {
+                farthest = max(farthest, texelFetch(hiz, ivec2(x, y), level).r);
+            }
+        }
+        return nearest > farthest;
+    }
+
+    void main() {
+        uint i = gl_GlobalInvocationID.x;
+        if (i >= object_count) {
+            return;
+        }
+        CullObject object = objects[i];
+        for (int p = 0; p < 6; ++p) {
+            if (dot(planes[p].xyz, object.sphere.xyz) + planes[p].w < -object.sphere.w) {
+                return;
+            }
+        }
+        if (hiz_levels > 0 && occluded(object.sphere)) {
+            return;
+        }
+        uint slot = atomicAdd(draw_count, 1u);
+        commands[slot] = Command(object.count, 1u, object.first_index, object.base_vertex, object.draw);
+    }
+)";
+} // namespace
+
+CullingPass::CullingPass(GLsizei max_objects)
+    : program(cull_source), capacity_(max_objects) {
+  glCreateBuffers(1, &objects_);
+  glNamedBufferStorage(objects_, sizeof(CullObject) * capacity_, nullptr,
+                       GL_DYNAMIC_STORAGE_BIT);
+  glCreateBuffers(1, &commands_);
+  glNamedBufferStorage(commands_,
+                       sizeof(DrawElementsIndirectCommand) * capacity_,
+                       nullptr, 0);
+  glCreateBuffers(1, &count_);
+  glNamedBufferStorage(count_, sizeof(GLuint), nullptr,
+                       GL_DYNAMIC_STORAGE_BIT);
+}
+
+CullingPass::~CullingPass() {
+  GLuint buffers[]{objects_, commands_, count_};
+  glDeleteBuffers(3, buffers);
+}
+
+void CullingPass::set_objects(std::span<const CullObject> objects,
+                              GLsizei first) {
+  if (first + static_cast<GLsizei>(objects.size()) > capacity_) {
+    std::cout << "ERROR::CULLING_PASS::OUT_OF_SPACE\n"
+              << first + objects.size() << " objects, " << capacity_
+              << " max" << std::endl;
+    return;
+  }
+  if (objects.empty()) {
+    return;
+  }
+  glNamedBufferSubData(objects_, sizeof(CullObject) * first,
+                       static_cast<GLsizeiptr>(objects.size_bytes()),
+                       objects.data());
+  object_count =
+      std::max(object_count, first + static_cast<GLsizei>(objects.size()));
+}
+
+void CullingPass::truncate(GLsizei count) {
+  object_count = std::min(object_count, count);
+}
+
+void CullingPass::cull(const glm::mat4 &view_proj, const HiZPyramid *hiz) {
+  GLuint zero{0};
+  glNamedBufferSubData(count_, 0, sizeof(GLuint), &zero);
+  if (object_count == 0) {
+    return;
+  }
+  Frustum frustum{view_proj};
+  glUseProgram(program);
+  glUniform1ui(glGetUniformLocation(program, "object_count"),
+               static_cast<GLuint>(object_count));
+  glUniform4fv(glGetUniformLocation(program, "planes"), 6,
+               glm::value_ptr(frustum.planes[0]));
+  glUniform1i(glGetUniformLocation(program, "hiz_levels"),
+              hiz ? hiz->levels() : 0);
+  if (hiz) {
+    hiz->bind(0);
+    glUniform1i(glGetUniformLocation(program, "hiz"), 0);
+    glUniformMatrix4fv(glGetUniformLocation(program, "hiz_view_proj"), 1,
+                       GL_FALSE, glm::value_ptr(hiz->view_proj()));
+  }
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, objects_binding, objects_);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, commands_binding, commands_);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, count_binding, count_);
+  glDispatchCompute(static_cast<GLuint>((object_count + 63) / 64), 1, 1);
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void CullingPass::draw(const GeometryArena &geometry, GLenum mode) const {
+  if (object_count == 0) {
+    return;
+  }
+  geometry.bind();
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands_);
+  glBindBuffer(GL_PARAMETER_BUFFER, count_);
+  glMultiDrawElementsIndirectCount(mode, GL_UNSIGNED_INT, nullptr, 0,
+                                   object_count, 0);
+  glBindBuffer(GL_PARAMETER_BUFFER, 0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
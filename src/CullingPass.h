@@ -0,0 +1,71 @@
+#ifndef OPENGLTEMPL_CULLINGPASS_H
+#define OPENGLTEMPL_CULLINGPASS_H
+
+#include <glad/glad.h>
+
+#include "GeometryArena.h"
+#include "HiZPyramid.h"
+#include "Program.h"
+
+#include <glm/glm.hpp>
+#include <span>
+
+// std430 mirror of the cull shader's CullObject
+struct CullObject {
+  glm::vec4 sphere; // world space center and radius
+  GLuint count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint draw; // DrawData index, becomes the command's base instance
+
+  static CullObject from(const MeshRange &mesh, const glm::vec4 &sphere,
+                         GLuint draw) {
+    return {sphere, static_cast<GLuint>(mesh.count), mesh.first_index,
+            mesh.base_vertex, draw};
+  }
+};
+
+// Culls objects on the GPU. A compute pass tests every object's bounding
+// sphere against the frustum and last frame's HiZPyramid and appends the
+// survivors to an indirect command buffer the pass owns, draw() submits them
+// with glMultiDrawElementsIndirectCount so the CPU never sees the result.
+// Objects stay on the GPU between frames, only changes are uploaded.
+//
+// Vertex shaders read their DrawData with BatchRenderer::glsl, the caller
+// keeps that buffer bound at BatchRenderer::draw_binding.
+class CullingPass {
+private:
+  Program program;
+  GLuint objects_{}, commands_{}, count_{};
+  GLsizei capacity_;
+  GLsizei object_count{0};
+
+public:
+  // Storage buffer bindings used while culling
+  static constexpr GLuint objects_binding = 1;
+  static constexpr GLuint commands_binding = 2;
+  static constexpr GLuint count_binding = 3;
+
+  explicit CullingPass(GLsizei max_objects = 1 << 17);
+  ~CullingPass();
+
+  CullingPass(const CullingPass &) = delete;
+  CullingPass &operator=(const CullingPass &) = delete;
+
+  // Overwrites objects from first on, growing the object count to cover them
+  void set_objects(std::span<const CullObject> objects, GLsizei first = 0);
+  // Drops the objects from count on
+  void truncate(GLsizei count);
+
+  // view_proj is the frame's Camera::camera_matrix. Without a pyramid only
+  // the frustum test runs.
+  void cull(const glm::mat4 &view_proj, const HiZPyramid *hiz = nullptr);
+
+  // Draws whatever survived the last cull(), the program has to be in use
+  void draw(const GeometryArena &geometry, GLenum mode = GL_TRIANGLES) const;
+
+  GLsizei size() const { return object_count; }
+  GLsizei capacity() const { return capacity_; }
+};
+
+#endif // OPENGLTEMPL_CULLINGPASS_H
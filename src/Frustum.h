@@ -0,0 +1,38 @@
+#ifndef OPENGLTEMPL_FRUSTUM_H
+#define OPENGLTEMPL_FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// The six planes of a view projection matrix (Gribb & Hartmann), normalised
+// and facing inwards, in the space the matrix transforms from.
+struct Frustum {
+  glm::vec4 planes[6];
+
+  explicit Frustum(const glm::mat4 &view_proj) {
+    auto row = [&](int i) {
+      return glm::vec4(view_proj[0][i], view_proj[1][i], view_proj[2][i],
+                       view_proj[3][i]);
+    };
+    for (int i = 0; i < 3; ++i) {
+      planes[2 * i] = row(3) + row(i);
+      planes[2 * i + 1] = row(3) - row(i);
+    }
+    for (glm::vec4 &plane : planes) {
+      plane = plane / glm::length(glm::vec3(plane.x, plane.y, plane.z));
+    }
+  }
+
+  // sphere is a center and radius
+  bool intersects(const glm::vec4 &sphere) const {
+    for (const glm::vec4 &plane : planes) {
+      if (plane.x * sphere.x + plane.y * sphere.y + plane.z * sphere.z +
+              plane.w <
+          -sphere.w) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+#endif // OPENGLTEMPL_FRUSTUM_H
@@ -0,0 +1,42 @@
+#include "GeometryArena.h"
+
+GeometryArena::GeometryArena(std::span<const Attribute> attribs,
+                             uint32_t stride, uint32_t vertex_bytes,
+                             uint32_t index_bytes)
+    : vertices_(vertex_bytes), indices_(index_bytes), stride_(stride) {
+  glCreateVertexArrays(1, &vao_);
+  for (const Attribute &attrib : attribs) {
+    glEnableVertexArrayAttrib(vao_, attrib.attrib_index);
+    glVertexArrayAttribBinding(vao_, attrib.attrib_index, 0);
+    glVertexArrayAttribFormat(vao_, attrib.attrib_index,
+                              attrib.type_size.second, attrib.type_size.first,
+                              attrib.normalized,
+                              static_cast<GLuint>(attrib.offset));
+  }
+  glVertexArrayVertexBuffer(vao_, 0, vertices_, 0,
+                            static_cast<GLsizei>(stride_));
+  glVertexArrayElementBuffer(vao_, indices_);
+}
+
+GeometryArena::~GeometryArena() { glDeleteVertexArrays(1, &vao_); }
+
+MeshRange GeometryArena::add(std::span<const std::byte> vertices,
+                             std::span<const GLuint> indices) {
+  // Stride alignment makes the offset a whole number of vertices
+  MeshRange mesh;
+  mesh.vertices = vertices_.upload(vertices, stride_);
+  mesh.indices = indices_.upload(std::as_bytes(indices), sizeof(GLuint));
+  if (!mesh.valid()) {
+    remove(mesh);
+    return {};
+  }
+  mesh.base_vertex = static_cast<GLint>(mesh.vertices.offset / stride_);
+  mesh.first_index = mesh.indices.offset / sizeof(GLuint);
+  mesh.count = static_cast<GLsizei>(indices.size());
+  return mesh;
+}
+
+void GeometryArena::remove(const MeshRange &mesh) {
+  vertices_.free(mesh.vertices);
+  indices_.free(mesh.indices);
+}
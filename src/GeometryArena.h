@@ -0,0 +1,68 @@
+#ifndef OPENGLTEMPL_GEOMETRYARENA_H
+#define OPENGLTEMPL_GEOMETRYARENA_H
+
+#include <glad/glad.h>
+
+#include "Attribute.h"
+#include "BufferArena.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Where a mesh lives inside a GeometryArena
+struct MeshRange {
+  BufferArena::Range vertices, indices;
+  GLint base_vertex{};
+  GLuint first_index{};
+  GLsizei count{};
+
+  bool valid() const { return vertices.valid() && indices.valid(); }
+};
+
+// Vertex and index arenas shared by every mesh with the same vertex layout,
+// behind a single VAO. Bind once and draw any number of meshes with base
+// vertex and first index offsets, no buffer or VAO switches in between.
+class GeometryArena {
+private:
+  BufferArena vertices_;
+  BufferArena indices_;
+  GLuint vao_{};
+  uint32_t stride_;
+
+public:
+  GeometryArena(std::span<const Attribute> attribs, uint32_t stride,
+                uint32_t vertex_bytes = 64u << 20,
+                uint32_t index_bytes = 32u << 20);
+  ~GeometryArena();
+
+  GeometryArena(const GeometryArena &) = delete;
+  GeometryArena &operator=(const GeometryArena &) = delete;
+
+  // Vertices are stride bytes each. Returns an invalid range (and keeps
+  // nothing) when either arena is full.
+  MeshRange add(std::span<const std::byte> vertices,
+                std::span<const GLuint> indices);
+  template <typename T>
+  MeshRange add(std::span<const T> vertices, std::span<const GLuint> indices) {
+    return add(std::as_bytes(vertices), indices);
+  }
+  void remove(const MeshRange &mesh);
+
+  void bind() const { glBindVertexArray(vao_); }
+  // Expects bind(), GL_UNSIGNED_INT indices
+  void draw(const MeshRange &mesh, GLenum mode = GL_TRIANGLES) const {
+    glDrawElementsBaseVertex(
+        mode, mesh.count, GL_UNSIGNED_INT,
+        reinterpret_cast<const void *>(mesh.first_index * sizeof(GLuint)),
+        mesh.base_vertex);
+  }
+
+  uint32_t stride() const { return stride_; }
+  const BufferArena &vertex_buffer() const { return vertices_; }
+  const BufferArena &index_buffer() const { return indices_; }
+
+  operator GLuint() const { return vao_; }
+};
+
+#endif // OPENGLTEMPL_GEOMETRYARENA_H
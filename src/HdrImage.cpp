@@ -0,0 +1,68 @@
+#include "HdrImage.h"
+
+#include <cmath>
+
+uint32_t pack_rgb9_e5(const float rgb[3]) {
+  // EXT_texture_shared_exponent: 9 bit mantissas, 5 bit exponent, bias 15
+  constexpr int mantissa_bits = 9, bias = 15;
+  constexpr float max_value = 511.0f / 512.0f * 65536.0f;
+  float c[3];
+  for (int i = 0; i < 3; ++i) {
+    c[i] = rgb[i] > 0 ? std::min(rgb[i], max_value) : 0.0f;
+  }
+  float max_c = std::max({c[0], c[1], c[2]});
+  int exponent =
+      std::max(-bias - 1, static_cast<int>(std::floor(std::log2(
+                              std::max(max_c, 1e-30f))))) +
+      1 + bias;
+  float scale = std::exp2(static_cast<float>(exponent - bias - mantissa_bits));
+  if (static_cast<int>(std::floor(max_c / scale + 0.5f)) ==
+      1 << mantissa_bits) {
+    ++exponent;
+    scale *= 2;
+  }
+  uint32_t packed = static_cast<uint32_t>(exponent) << 27;
+  for (int i = 0; i < 3; ++i) {
+    packed |= static_cast<uint32_t>(std::floor(c[i] / scale + 0.5f))
+              << (i * 9);
+  }
+  return packed;
+}
+
+uint32_t pack_r11f_g11f_b10f(const float rgb[3]) {
+  // Same 5 bit exponent as a half, so round the half's mantissa down to 6
+  // (or 5) bits. Inputs are clamped to the largest finite value first.
+  auto narrow = [](float value, float max_value, int drop) {
+    uint32_t half = float_to_half(std::min(value, max_value));
+    return (half + (1u << (drop - 1))) >> drop;
+  };
+  return narrow(rgb[0], 65024.0f, 4) | narrow(rgb[1], 65024.0f, 4) << 11 |
+         narrow(rgb[2], 64512.0f, 5) << 22;
+}
+
+PackedHdrImage pack(const HdrImage &image, HdrFormat format, ThreadPool *pool) {
+  PackedHdrImage packed{format, image.width, image.height, {}};
+  auto pack_texel = format == HdrFormat::RGB9_E5 ? pack_rgb9_e5
+                                                 : pack_r11f_g11f_b10f;
+  for (size_t level = 0; level < image.level_count(); ++level) {
+    std::span<const float> floats = image.level(level);
+    std::vector<uint32_t> &out = packed.levels.emplace_back(floats.size() / 3);
+    constexpr size_t texels_per_task = 16384;
+    size_t tasks = (out.size() + texels_per_task - 1) / texels_per_task;
+    auto run = [&](size_t task) {
+      size_t first = task * texels_per_task;
+      size_t last = std::min(first + texels_per_task, out.size());
+      for (size_t i = first; i < last; ++i) {
+        out[i] = pack_texel(&floats[i * 3]);
+      }
+    };
+    if (pool) {
+      pool->parallel_for(tasks, run);
+    } else {
+      for (size_t task = 0; task < tasks; ++task) {
+        run(task);
+      }
+    }
+  }
+  return packed;
+}
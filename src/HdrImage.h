@@ -0,0 +1,112 @@
+#ifndef OPENGLTEMPL_HDRIMAGE_H
+#define OPENGLTEMPL_HDRIMAGE_H
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+// Linear RGB floats from .hdr (or any file stbi_loadf takes). Never uploaded
+// as is, see pack() and compress().
+struct HdrImage {
+  int width{}, height{};
+  std::vector<float> pixels;
+  // Levels 1.. of the mip chain, filled in by generate_mips()
+  std::vector<std::vector<float>> mips;
+
+  static constexpr int channels = 3;
+
+  bool empty() const { return pixels.empty(); }
+  size_t level_count() const { return 1 + mips.size(); }
+  int level_width(size_t level) const { return std::max(1, width >> level); }
+  int level_height(size_t level) const { return std::max(1, height >> level); }
+  std::span<const float> level(size_t i) const {
+    return i == 0 ? std::span<const float>{pixels}
+                  : std::span<const float>{mips[i - 1]};
+  }
+
+  static bool is_hdr(std::span<const unsigned char> encoded) {
+    return stbi_is_hdr_from_memory(encoded.data(),
+                                   static_cast<int>(encoded.size())) != 0;
+  }
+
+  static HdrImage load(std::span<const unsigned char> encoded) {
+    int w, h, n;
+    float *floats =
+        stbi_loadf_from_memory(encoded.data(), static_cast<int>(encoded.size()),
+                               &w, &h, &n, channels);
+    if (!floats) {
+      return {};
+    }
+    HdrImage image{w, h, {}, {}};
+    image.pixels.assign(floats, floats + static_cast<size_t>(w) * h * channels);
+    stbi_image_free(floats);
+    return image;
+  }
+};
+
+// 32 bits a texel instead of the 96 (or 128) of RGB(A)32F
+enum class HdrFormat { RGB9_E5, R11F_G11F_B10F };
+
+// Every level of a packed mip chain, level 0 first.
+struct PackedHdrImage {
+  HdrFormat format{};
+  int width{}, height{};
+  std::vector<std::vector<uint32_t>> levels;
+
+  bool empty() const { return levels.empty(); }
+  int level_width(size_t level) const { return std::max(1, width >> level); }
+  int level_height(size_t level) const { return std::max(1, height >> level); }
+};
+
+constexpr GLenum internal_format(HdrFormat format) {
+  return format == HdrFormat::RGB9_E5 ? GL_RGB9_E5 : GL_R11F_G11F_B10F;
+}
+
+// Type to hand glTextureSubImage2D along with GL_RGB
+constexpr GLenum pixel_type(HdrFormat format) {
+  return format == HdrFormat::RGB9_E5 ? GL_UNSIGNED_INT_5_9_9_9_REV
+                                      : GL_UNSIGNED_INT_10F_11F_11F_REV;
+}
+
+// Round to nearest half float, for the non-negative values HDR formats keep.
+// Negatives and NaN become 0, too large values the largest finite half.
+inline uint16_t float_to_half(float value) {
+  if (!(value > 0)) {
+    return 0;
+  }
+  value = std::min(value, 65504.0f);
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  int exponent = static_cast<int>(bits >> 23) - 127 + 15;
+  uint32_t mantissa = bits & 0x7FFFFF;
+  if (exponent <= 0) {
+    // Denormal half, shift the implicit one in
+    if (exponent < -10) {
+      return 0;
+    }
+    mantissa |= 0x800000;
+    int shift = 14 - exponent;
+    return static_cast<uint16_t>((mantissa + (1u << (shift - 1))) >> shift);
+  }
+  // A mantissa carry bumps the exponent, which is exactly right
+  return static_cast<uint16_t>(
+      (static_cast<uint32_t>(exponent) << 10 | mantissa >> 13) +
+      ((mantissa >> 12) & 1));
+}
+
+uint32_t pack_rgb9_e5(const float rgb[3]);
+uint32_t pack_r11f_g11f_b10f(const float rgb[3]);
+
+// Packs every level the image carries, run generate_mips() first.
+PackedHdrImage pack(const HdrImage &image, HdrFormat format,
+                    ThreadPool *pool = nullptr);
+
+#endif // OPENGLTEMPL_HDRIMAGE_H
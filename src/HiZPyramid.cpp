@@ -0,0 +1,90 @@
+#include "HiZPyramid.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+const std::string reduce_source = R"(
+    #version 460 core
+    layout (local_size_x = 8, local_size_y = 8) in;
+
+    uniform sampler2D depth;
+    uniform bool from_depth;
+    layout (r32f, binding = 0) readonly uniform image2D source;
+    layout (r32f, binding = 1) writeonly uniform image2D target;
+
+    void main() {
+        ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+        ivec2 size = imageSize(target);
+        if (any(greaterThanEqual(texel, size))) {
+            return;
+        }
+        if (from_depth) {
+            imageStore(target, texel, vec4(texelFetch(depth, texel, 0).r));
+            return;
+        }
+        // An odd source folds its last row or column into the last texel
+        ivec2 source_size = imageSize(source);
+        ivec2 extent = ivec2(2) + ivec2(equal(texel, size - 1)) * (source_size & 1);
+        float farthest = 0.0;
+        for (int y = 0; y < extent.y; ++y) {
+            for (int x = 0; x < extent.x; ++x) {
+                ivec2 at = min(texel * 2 + ivec2(x, y), source_size - 1);
+                farthest = max(farthest, imageLoad(source, at).r);
+            }
+        }
+        imageStore(target, texel, vec4(farthest));
+    }
+)";
+
+GLuint groups(int size) { return static_cast<GLuint>((size + 7) / 8); }
+} // namespace
+
+HiZPyramid::HiZPyramid(int width, int height)
+    : program(reduce_source), width_(width), height_(height),
+      levels_(std::bit_width(static_cast<unsigned>(std::max(width, height)))) {
+  glCreateTextures(GL_TEXTURE_2D, 1, &id_);
+  glTextureParameteri(id_, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  glTextureParameteri(id_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTextureParameteri(id_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTextureParameteri(id_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTextureStorage2D(id_, levels_, GL_R32F, width_, height_);
+}
+
+HiZPyramid::~HiZPyramid() {
+  GLuint textures[]{id_, depth_};
+  glDeleteTextures(2, textures);
+}
+
+void HiZPyramid::build(GLuint depth, const glm::mat4 &view_proj) {
+  view_proj_ = view_proj;
+  glUseProgram(program);
+  glBindTextureUnit(0, depth);
+  glUniform1i(glGetUniformLocation(program, "depth"), 0);
+  GLint from_depth = glGetUniformLocation(program, "from_depth");
+
+  glUniform1i(from_depth, GL_TRUE);
+  glBindImageTexture(1, id_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+  glDispatchCompute(groups(width_), groups(height_), 1);
+
+  glUniform1i(from_depth, GL_FALSE);
+  for (GLsizei level = 1; level < levels_; ++level) {
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    glBindImageTexture(0, id_, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+    glBindImageTexture(1, id_, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute(groups(std::max(1, width_ >> level)),
+                      groups(std::max(1, height_ >> level)), 1);
+  }
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void HiZPyramid::capture(const glm::mat4 &view_proj) {
+  if (!depth_) {
+    glCreateTextures(GL_TEXTURE_2D, 1, &depth_);
+    glTextureParameteri(depth_, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(depth_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureStorage2D(depth_, 1, GL_DEPTH_COMPONENT24, width_, height_);
+  }
+  glCopyTextureSubImage2D(depth_, 0, 0, 0, 0, 0, width_, height_);
+  build(depth_, view_proj);
+}
@@ -0,0 +1,47 @@
+#ifndef OPENGLTEMPL_HIZPYRAMID_H
+#define OPENGLTEMPL_HIZPYRAMID_H
+
+#include <glad/glad.h>
+
+#include "Program.h"
+
+#include <glm/glm.hpp>
+
+// Max reduced depth mip chain (R32F) for occlusion culling. Every texel holds
+// the farthest depth under it, so anything nearer than that at a level where
+// its screen rect covers at most 2x2 texels may be visible.
+class HiZPyramid {
+private:
+  GLuint id_{};
+  // Copy of a framebuffer's depth for capture(), made on first use
+  GLuint depth_{};
+  Program program;
+  int width_, height_;
+  GLsizei levels_;
+  glm::mat4 view_proj_{1.0f};
+
+public:
+  HiZPyramid(int width, int height);
+  ~HiZPyramid();
+
+  HiZPyramid(const HiZPyramid &) = delete;
+  HiZPyramid &operator=(const HiZPyramid &) = delete;
+
+  // depth is a depth texture of the same size, view_proj what it was rendered
+  // with. Used by next frame's culling, so the matrix is kept alongside.
+  void build(GLuint depth, const glm::mat4 &view_proj);
+  // Builds from the depth of the framebuffer bound for reading (the window's
+  // by default), which can't be sampled directly, by copying it first.
+  void capture(const glm::mat4 &view_proj);
+
+  void bind(GLuint unit) const { glBindTextureUnit(unit, id_); }
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  GLsizei levels() const { return levels_; }
+  const glm::mat4 &view_proj() const { return view_proj_; }
+
+  operator GLuint() const { return id_; }
+};
+
+#endif // OPENGLTEMPL_HIZPYRAMID_H
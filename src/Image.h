@@ -0,0 +1,64 @@
+#ifndef OPENGLTEMPL_IMAGE_H
+#define OPENGLTEMPL_IMAGE_H
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+// Decoded pixels living in CPU memory. Safe to build on any thread.
+struct Image {
+  int width{}, height{}, channels{};
+  std::vector<unsigned char> pixels;
+  // Levels 1.. of the mip chain, filled in by generate_mips()
+  std::vector<std::vector<unsigned char>> mips;
+
+  bool empty() const { return pixels.empty(); }
+  size_t size_bytes() const {
+    size_t bytes = pixels.size();
+    for (const auto &mip : mips) {
+      bytes += mip.size();
+    }
+    return bytes;
+  }
+
+  size_t level_count() const { return 1 + mips.size(); }
+  int level_width(size_t level) const { return std::max(1, width >> level); }
+  int level_height(size_t level) const { return std::max(1, height >> level); }
+  std::span<const unsigned char> level(size_t i) const {
+    return i == 0 ? std::span<const unsigned char>{pixels}
+                  : std::span<const unsigned char>{mips[i - 1]};
+  }
+
+  static Image load(const std::string &path, int desired_channels = 0) {
+    int w, h, n;
+    stbi_uc *bytes = stbi_load(path.c_str(), &w, &h, &n, desired_channels);
+    return adopt(bytes, w, h, desired_channels ? desired_channels : n);
+  }
+
+  // Decodes an encoded file that is already in memory (or mapped)
+  static Image load(std::span<const unsigned char> encoded,
+                    int desired_channels = 0) {
+    int w, h, n;
+    stbi_uc *bytes =
+        stbi_load_from_memory(encoded.data(), static_cast<int>(encoded.size()),
+                              &w, &h, &n, desired_channels);
+    return adopt(bytes, w, h, desired_channels ? desired_channels : n);
+  }
+
+private:
+  static Image adopt(stbi_uc *bytes, int w, int h, int n) {
+    if (!bytes) {
+      return {};
+    }
+    Image image{w, h, n, {}, {}};
+    image.pixels.assign(bytes, bytes + static_cast<size_t>(w) * h * n);
+    stbi_image_free(bytes);
+    return image;
+  }
+};
+
+#endif // OPENGLTEMPL_IMAGE_H
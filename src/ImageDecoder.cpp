@@ -0,0 +1,184 @@
+#include "ImageDecoder.h"
+
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+#if defined(OPENGLTEMPL_LIBJPEG)
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+#endif
+
+namespace {
+
+std::atomic<bool> flip_on_load{false};
+
+void flip_rows(Image &image) {
+  size_t pitch = static_cast<size_t>(image.width) * image.channels;
+  unsigned char *top = image.pixels.data();
+  unsigned char *bottom = top + (image.height - 1) * pitch;
+  for (; top < bottom; top += pitch, bottom -= pitch) {
+    std::swap_ranges(top, top + pitch, bottom);
+  }
+}
+
+class StbDecoder final : public ImageDecoder {
+public:
+  const char *name() const override { return "stb_image"; }
+  bool accepts(std::span<const unsigned char>) const override { return true; }
+  Image decode(std::span<const unsigned char> encoded, int desired_channels,
+               int) const override {
+    return Image::load(encoded, desired_channels);
+  }
+  bool flips() const override { return true; }
+};
+
+#if defined(OPENGLTEMPL_LIBJPEG)
+// libjpeg-turbo: SIMD IDCT and colour conversion, and the IDCT can produce
+// 1/2, 1/4 or 1/8 size output directly so reduced tiers never decode the full
+// resolution.
+class JpegDecoder final : public ImageDecoder {
+private:
+  struct Error {
+    jpeg_error_mgr manager;
+    std::jmp_buf jump;
+  };
+
+  static void fail(j_common_ptr info) {
+    std::longjmp(reinterpret_cast<Error *>(info->err)->jump, 1);
+  }
+  static void quiet(j_common_ptr) {}
+
+  // Keeps every C++ object outside the frame libjpeg longjmps back into
+  static bool read(jpeg_decompress_struct &info,
+                   std::span<const unsigned char> encoded, int desired_channels,
+                   int max_reduction, Image &image) {
+    Error error;
+    info.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = fail;
+    error.manager.output_message = quiet;
+    if (setjmp(error.jump)) {
+      jpeg_destroy_decompress(&info);
+      return false;
+    }
+    jpeg_create_decompress(&info);
+    jpeg_mem_src(&info, encoded.data(), static_cast<unsigned long>(encoded.size()));
+    jpeg_read_header(&info, TRUE);
+    int channels = desired_channels ? desired_channels : info.num_components;
+    switch (channels) {
+    case 1:
+      info.out_color_space = JCS_GRAYSCALE;
+      break;
+    case 3:
+      info.out_color_space = JCS_RGB;
+      break;
+#if defined(JCS_ALPHA_EXTENSIONS)
+    case 4:
+      info.out_color_space = JCS_EXT_RGBA;
+      break;
+#endif
+    default:
+      // CMYK and friends, leave them to stb
+      jpeg_destroy_decompress(&info);
+      return false;
+    }
+    info.scale_num = 1;
+    info.scale_denom = 1u << std::clamp(max_reduction, 0, 3);
+    jpeg_start_decompress(&info);
+
+    image.width = static_cast<int>(info.output_width);
+    image.height = static_cast<int>(info.output_height);
+    image.channels = channels;
+    image.pixels.resize(static_cast<size_t>(image.width) * image.height *
+                        channels);
+    size_t pitch = static_cast<size_t>(image.width) * channels;
+    while (info.output_scanline < info.output_height) {
+      JSAMPROW rows[4];
+      for (int i = 0; i < 4; ++i) {
+        size_t row = std::min<size_t>(info.output_scanline + i,
+                                      info.output_height - 1);
+        rows[i] = image.pixels.data() + row * pitch;
+      }
+      jpeg_read_scanlines(&info, rows, 4);
+    }
+    jpeg_finish_decompress(&info);
+    jpeg_destroy_decompress(&info);
+    return true;
+  }
+
+public:
+  const char *name() const override { return "libjpeg-turbo"; }
+  bool accepts(std::span<const unsigned char> encoded) const override {
+    return encoded.size() > 3 && encoded[0] == 0xFF && encoded[1] == 0xD8 &&
+           encoded[2] == 0xFF;
+  }
+  Image decode(std::span<const unsigned char> encoded, int desired_channels,
+               int max_reduction) const override {
+    jpeg_decompress_struct info{};
+    Image image;
+    if (!read(info, encoded, desired_channels, max_reduction, image)) {
+      return {};
+    }
+    return image;
+  }
+};
+#endif
+
+} // namespace
+
+void set_flip_vertically_on_load(bool flip) {
+  flip_on_load = flip;
+  stbi_set_flip_vertically_on_load(flip);
+}
+
+std::span<const ImageDecoder *const> image_decoders() {
+#if defined(OPENGLTEMPL_LIBJPEG)
+  static const JpegDecoder jpeg;
+#endif
+  static const StbDecoder stb;
+  static const ImageDecoder *const decoders[]{
+#if defined(OPENGLTEMPL_LIBJPEG)
+      &jpeg,
+#endif
+      &stb};
+  return decoders;
+}
+
+bool image_size(std::span<const unsigned char> encoded, int &width,
+                int &height) {
+  int channels;
+  return stbi_info_from_memory(encoded.data(), static_cast<int>(encoded.size()),
+                               &width, &height, &channels) != 0;
+}
+
+Image decode_image(std::span<const unsigned char> encoded, int reduction,
+                   bool srgb, ThreadPool *pool, int desired_channels) {
+  int width{}, height{};
+  if (!image_size(encoded, width, height)) {
+    return {};
+  }
+  for (const ImageDecoder *decoder : image_decoders()) {
+    if (!decoder->accepts(encoded)) {
+      continue;
+    }
+    Image image = decoder->decode(encoded, desired_channels, reduction);
+    if (image.empty()) {
+      continue;
+    }
+    // Scaled decoders round up, 1/2^n of the width tells how far they went
+    int done{0};
+    while (done < reduction &&
+           ((width + (1 << done) - 1) >> done) > image.width) {
+      ++done;
+    }
+    downsample(image, reduction - done, srgb, pool);
+    if (flip_on_load && !decoder->flips()) {
+      flip_rows(image);
+    }
+    return image;
+  }
+  return {};
+}
@@ -0,0 +1,46 @@
+#ifndef OPENGLTEMPL_IMAGEDECODER_H
+#define OPENGLTEMPL_IMAGEDECODER_H
+
+#include "Image.h"
+#include "ThreadPool.h"
+
+#include <span>
+#include <vector>
+
+// One way of turning encoded bytes into pixels. Backends only take the files
+// they are good at and return an empty Image for anything else, decode_image()
+// then moves on to the next one. stb_image is always last.
+class ImageDecoder {
+public:
+  virtual ~ImageDecoder() = default;
+
+  virtual const char *name() const = 0;
+  // Cheap check of the signature, doesn't decode
+  virtual bool accepts(std::span<const unsigned char> encoded) const = 0;
+  // Decodes to 8 bits per channel, desired_channels 0 keeps the file's own.
+  // Backends that can decode at 1/2, 1/4 or 1/8 size do so for up to
+  // max_reduction halvings, the caller checks the size it got back.
+  virtual Image decode(std::span<const unsigned char> encoded,
+                       int desired_channels, int max_reduction) const = 0;
+  // Whether decode() already honours set_flip_vertically_on_load()
+  virtual bool flips() const { return false; }
+};
+
+// Replaces stbi_set_flip_vertically_on_load() so every backend agrees
+void set_flip_vertically_on_load(bool flip);
+
+// Every backend compiled in, fastest first, stb_image last
+std::span<const ImageDecoder *const> image_decoders();
+
+// Width and height from the header alone
+bool image_size(std::span<const unsigned char> encoded, int &width,
+                int &height);
+
+// Decodes with the first backend that manages and reduces the result by
+// reduction halvings, see reduction_levels(). Whatever the backend didn't
+// scale away during decoding goes through downsample().
+Image decode_image(std::span<const unsigned char> encoded, int reduction = 0,
+                   bool srgb = false, ThreadPool *pool = nullptr,
+                   int desired_channels = 0);
+
+#endif // OPENGLTEMPL_IMAGEDECODER_H
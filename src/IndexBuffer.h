@@ -8,6 +8,50 @@
 #include <span>
 #include <glad/glad.h>
 
+#include <cstddef>
+#include <iostream>
+#include <optional>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+template<typename T>
+constexpr GLenum index_type() {
+    static_assert(std::is_same_v<T, GLubyte> || std::is_same_v<T, GLushort> || std::is_same_v<T, GLuint>,
+                  "GL indices are GLubyte, GLushort or GLuint");
+    if constexpr (std::is_same_v<T, GLubyte>) {
+        return GL_UNSIGNED_BYTE;
+    } else if constexpr (std::is_same_v<T, GLushort>) {
+        return GL_UNSIGNED_SHORT;
+    } else {
+        return GL_UNSIGNED_INT;
+    }
+}
+
+// Smallest index type that still addresses vertex_count vertices. Never bytes: most hardware has no native byte
+// index fetch and the driver widens them on every draw.
+constexpr GLenum narrowest_index_type(size_t vertex_count) {
+    return vertex_count <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+using NarrowIndices = std::variant<std::vector<GLushort>, std::vector<GLuint>>;
+
+// Import time pass, copies indices into the narrowest type vertex_count allows. std::visit the result to build
+// an IndexBuffer of the matching type. Nothing when an index is out of range, narrowing would wrap it.
+inline std::optional<NarrowIndices> narrow_indices(std::span<const GLuint> indices, size_t vertex_count) {
+    for (GLuint index: indices) {
+        if (index >= vertex_count) {
+            std::cout << "ERROR::INDEX_BUFFER::INDEX_OUT_OF_RANGE\n" << index << " >= " << vertex_count
+                      << std::endl;
+            return std::nullopt;
+        }
+    }
+    if (narrowest_index_type(vertex_count) == GL_UNSIGNED_SHORT) {
+        return NarrowIndices{std::vector<GLushort>(indices.begin(), indices.end())};
+    }
+    return NarrowIndices{std::vector<GLuint>(indices.begin(), indices.end())};
+}
+
 template<typename T>
 class IndexBuffer {
 private:
@@ -16,15 +60,24 @@ private:
     GLenum draw_mode{GL_TRIANGLES};
 
 public:
+    static constexpr GLenum gl_type = index_type<T>();
+
     explicit IndexBuffer(const std::span<T> &data);
     virtual ~IndexBuffer();
 
+    // A copy would delete the buffer out from under the original
+    IndexBuffer(const IndexBuffer &) = delete;
+    IndexBuffer &operator=(const IndexBuffer &) = delete;
+
     GLsizei get_size() const {
         return data_.size();
     }
     GLenum get_draw_mode() const {
         return draw_mode;
     }
+    GLenum get_index_type() const {
+        return gl_type;
+    }
     operator GLuint() const {return id_;}
 };
 
@@ -0,0 +1,42 @@
+#include "InstanceBatcher.h"
+
+#include <algorithm>
+#include <span>
+#include <tuple>
+
+void InstanceBatcher::flush() {
+  if (draws.empty()) {
+    return;
+  }
+  auto key = [](const Draw &draw) {
+    return std::make_tuple(static_cast<GLuint>(*draw.program), draw.vao,
+                           draw.positions);
+  };
+  std::stable_sort(draws.begin(), draws.end(),
+                   [&](const Draw &a, const Draw &b) { return key(a) < key(b); });
+
+  instances.clear();
+  for (const Draw &draw : draws) {
+    instances.push_back(draw.data);
+  }
+  StreamBuffer::Slice slice =
+      stream.storage(std::span<const DrawData>{instances});
+  if (slice.valid()) {
+    stream.bind_storage(BatchRenderer::draw_binding, slice);
+    // Group members are adjacent now, each group's DrawData starts at its
+    // first member
+    for (size_t first = 0; first < draws.size();) {
+      size_t last = first + 1;
+      while (last < draws.size() && key(draws[last]) == key(draws[first])) {
+        ++last;
+      }
+      const Draw &draw = draws[first];
+      glUseProgram(*draw.program);
+      draw.issue(draw.vao, *draw.program, static_cast<GLsizei>(last - first),
+                 static_cast<GLuint>(first));
+      ++frame_draw_calls;
+      first = last;
+    }
+  }
+  draws.clear();
+}
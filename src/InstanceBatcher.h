@@ -0,0 +1,84 @@
+#ifndef OPENGLTEMPL_INSTANCEBATCHER_H
+#define OPENGLTEMPL_INSTANCEBATCHER_H
+
+#include <glad/glad.h>
+
+#include "BatchRenderer.h"
+#include "Program.h"
+#include "StreamBuffer.h"
+#include "VertexArray.h"
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Draw anything through submit() and objects sharing a program and
+// VertexArray (so its textures) come out as one instanced draw, no opting in
+// needed. Transforms and materials are streamed as DrawData, shaders read
+// theirs with BatchRenderer::glsl exactly like a batched draw, so objects
+// whose materials are TextureArray layers still share a draw.
+//
+// Draws are regrouped, so only opaque geometry should go through here.
+class InstanceBatcher {
+private:
+  using Issue = void (*)(void *vao, const Program &program, GLsizei count,
+                         GLuint base_instance);
+
+  struct Draw {
+    void *vao;
+    const Program *program;
+    Issue issue;
+    // Through VertexArray::draw_positions(), never grouped with full draws
+    bool positions;
+    DrawData data;
+  };
+
+  StreamBuffer &stream;
+  std::vector<Draw> draws;
+  std::vector<DrawData> instances;
+  size_t frame_draw_calls{0};
+  size_t last_draw_calls_{0};
+
+public:
+  explicit InstanceBatcher(StreamBuffer &stream_buffer)
+      : stream(stream_buffer) {}
+
+  // Nothing is drawn until flush(), vao and program have to outlive it
+  template <typename T, typename U>
+  void submit(VertexArray<T, U> &vao, const Program &program,
+              const glm::mat4 &model, GLuint material = 0) {
+    Issue issue = [](void *erased, const Program &p, GLsizei count,
+                     GLuint base_instance) {
+      static_cast<VertexArray<T, U> *>(erased)->draw_instanced(p, count,
+                                                                base_instance);
+    };
+    draws.push_back({&vao, &program, issue, false, {model, material, {}}});
+  }
+
+  // Geometry only, for depth prepasses. Split meshes fetch nothing but their
+  // positions, see VertexArray::draw_positions().
+  template <typename T, typename U>
+  void submit_positions(VertexArray<T, U> &vao, const Program &program,
+                        const glm::mat4 &model) {
+    Issue issue = [](void *erased, const Program &, GLsizei count,
+                     GLuint base_instance) {
+      static_cast<VertexArray<T, U> *>(erased)->draw_positions(count,
+                                                                base_instance);
+    };
+    draws.push_back({&vao, &program, issue, true, {model, 0, {}}});
+  }
+
+  // Groups, streams and draws everything submitted since the last flush. Has
+  // to run between the stream's begin and end_frame(), any number of times.
+  void flush();
+
+  // Call where the frame starts, last_draw_calls() then covers every flush of
+  // the frame before
+  void begin_frame() {
+    last_draw_calls_ = frame_draw_calls;
+    frame_draw_calls = 0;
+  }
+  size_t last_draw_calls() const { return last_draw_calls_; }
+};
+
+#endif // OPENGLTEMPL_INSTANCEBATCHER_H
@@ -0,0 +1,82 @@
+#ifndef OPENGLTEMPL_LOCKFREEQUEUE_H
+#define OPENGLTEMPL_LOCKFREEQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+// Bounded multi-producer multi-consumer queue (Vyukov). Each cell carries a
+// sequence number so producers and consumers only ever contend on one counter.
+template <typename T> class LockFreeQueue {
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  static constexpr size_t cache_line = 64;
+
+  std::unique_ptr<Cell[]> cells;
+  size_t mask;
+  alignas(cache_line) std::atomic<size_t> enqueue_pos{0};
+  alignas(cache_line) std::atomic<size_t> dequeue_pos{0};
+
+public:
+  // capacity must be a power of two
+  explicit LockFreeQueue(size_t capacity)
+      : cells(new Cell[capacity]), mask(capacity - 1) {
+    for (size_t i = 0; i < capacity; ++i) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  LockFreeQueue(const LockFreeQueue &) = delete;
+  LockFreeQueue &operator=(const LockFreeQueue &) = delete;
+
+  bool try_push(T &&value) {
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells[pos & mask];
+      size_t seq = cell.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq) -
+                  static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          cell.data = std::move(value);
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  std::optional<T> try_pop() {
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells[pos & mask];
+      size_t seq = cell.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq) -
+                  static_cast<std::ptrdiff_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          std::optional<T> value{std::move(cell.data)};
+          cell.sequence.store(pos + mask + 1, std::memory_order_release);
+          return value;
+        }
+      } else if (diff < 0) {
+        return std::nullopt; // empty
+      } else {
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+};
+
+#endif // OPENGLTEMPL_LOCKFREEQUEUE_H
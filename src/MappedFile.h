@@ -0,0 +1,104 @@
+#ifndef OPENGLTEMPL_MAPPEDFILE_H
+#define OPENGLTEMPL_MAPPEDFILE_H
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read only view of a whole file. Empty if the file couldn't be opened.
+class MappedFile {
+private:
+  const unsigned char *data_{};
+  size_t size_{};
+
+  void release() {
+    if (!data_) {
+      return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+#else
+    munmap(const_cast<unsigned char *>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+public:
+  MappedFile() = default;
+
+  explicit MappedFile(const std::string &path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      return;
+    }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+      HANDLE mapping =
+          CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping) {
+        data_ = static_cast<const unsigned char *>(
+            MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        size_ = data_ ? static_cast<size_t>(size.QuadPart) : 0;
+        CloseHandle(mapping);
+      }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+      void *mapped = mmap(nullptr, static_cast<size_t>(info.st_size),
+                          PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped != MAP_FAILED) {
+        data_ = static_cast<const unsigned char *>(mapped);
+        size_ = static_cast<size_t>(info.st_size);
+      }
+    }
+    close(fd);
+#endif
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  MappedFile(MappedFile &&other) noexcept
+      : data_(std::exchange(other.data_, nullptr)),
+        size_(std::exchange(other.size_, 0)) {}
+
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+      release();
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  ~MappedFile() { release(); }
+
+  bool valid() const { return data_ != nullptr; }
+  const unsigned char *data() const { return data_; }
+  size_t size() const { return size_; }
+  std::span<const unsigned char> bytes() const { return {data_, size_}; }
+};
+
+#endif // OPENGLTEMPL_MAPPEDFILE_H
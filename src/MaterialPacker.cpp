@@ -0,0 +1,90 @@
+#include "MaterialPacker.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace {
+struct Channel {
+  const Image *source;
+  int channel;
+  unsigned char fallback;
+};
+
+template <size_t N>
+Image interleave(const std::array<Channel, N> &channels) {
+  const Image *base{nullptr};
+  for (const Channel &c : channels) {
+    if (c.source && !c.source->empty()) {
+      base = c.source;
+      break;
+    }
+  }
+  if (!base) {
+    return {};
+  }
+  Image packed{base->width, base->height, static_cast<int>(N), {}, {}};
+  packed.pixels.resize(static_cast<size_t>(packed.width) * packed.height * N);
+  for (size_t c = 0; c < N; ++c) {
+    const Channel &channel = channels[c];
+    const Image *source = channel.source;
+    if (!source || source->empty()) {
+      for (size_t i = c; i < packed.pixels.size(); i += N) {
+        packed.pixels[i] = channel.fallback;
+      }
+      continue;
+    }
+    // Grey sources fill every colour channel
+    int sc = std::min(channel.channel, source->channels - 1);
+    for (int y = 0; y < packed.height; ++y) {
+      int sy = static_cast<int>(static_cast<int64_t>(y) * source->height /
+                                packed.height);
+      for (int x = 0; x < packed.width; ++x) {
+        int sx = static_cast<int>(static_cast<int64_t>(x) * source->width /
+                                  packed.width);
+        packed.pixels[(static_cast<size_t>(y) * packed.width + x) * N + c] =
+            source->pixels[(static_cast<size_t>(sy) * source->width + sx) *
+                               source->channels +
+                           sc];
+      }
+    }
+  }
+  return packed;
+}
+} // namespace
+
+std::vector<std::string> MaterialLayout::defines() const {
+  std::vector<std::string> defines;
+  if (specular_in_alpha) {
+    defines.emplace_back("MATERIAL_SPECULAR_IN_ALPHA");
+  }
+  if (scalar_map) {
+    defines.emplace_back("MATERIAL_SCALAR_MAP");
+  }
+  if (roughness) {
+    defines.emplace_back("MATERIAL_ROUGHNESS");
+  }
+  if (ao) {
+    defines.emplace_back("MATERIAL_AO");
+  }
+  return defines;
+}
+
+MaterialLayout material_layout(const MaterialPaths &paths) {
+  MaterialLayout layout;
+  layout.roughness = !paths.roughness.empty();
+  layout.ao = !paths.ao.empty();
+  layout.scalar_map = layout.roughness || layout.ao;
+  layout.specular_in_alpha = !layout.scalar_map && !paths.specular.empty();
+  return layout;
+}
+
+Image pack_material(Texture::TextureType type, std::span<const Image> maps) {
+  auto map = [&](size_t i) { return i < maps.size() ? &maps[i] : nullptr; };
+  if (type == Texture::TextureType::DIFFUSE) {
+    return interleave<4>({Channel{map(0), 0, 255}, Channel{map(0), 1, 255},
+                          Channel{map(0), 2, 255}, Channel{map(1), 0, 0}});
+  }
+  return interleave<3>({Channel{map(0), 0, 0}, Channel{map(1), 0, 255},
+                        Channel{map(2), 0, 255}});
+}
@@ -0,0 +1,39 @@
+#ifndef OPENGLTEMPL_MATERIALPACKER_H
+#define OPENGLTEMPL_MATERIALPACKER_H
+
+#include "Image.h"
+#include "Texture.h"
+
+#include <span>
+#include <string>
+#include <vector>
+
+// Source files of a material, empty paths are maps the material doesn't have.
+struct MaterialPaths {
+  std::string diffuse, specular, roughness, ao;
+};
+
+// Where the scalar maps of a material live once packed. Follows from which
+// maps exist, so the shader variant is known before anything is decoded:
+//  - specular only: diffuse RGB + specular in A, one texture (diff_0)
+//  - roughness or AO: diffuse RGB in diff_0, (specular, roughness, AO) in the
+//    RGB of spec_0
+struct MaterialLayout {
+  bool specular_in_alpha{false};
+  bool scalar_map{false};
+  bool roughness{false};
+  bool ao{false};
+
+  // MATERIAL_* defines for Program::with_defines()
+  std::vector<std::string> defines() const;
+};
+
+MaterialLayout material_layout(const MaterialPaths &paths);
+
+// Combines the decoded maps of a texture set up by TextureLoader::
+// load_material(): for DIFFUSE {diffuse, specular}, otherwise {specular,
+// roughness, AO}. Missing maps read as 0 for specular and 255 for the rest,
+// maps of another size are resampled to the first one's.
+Image pack_material(Texture::TextureType type, std::span<const Image> maps);
+
+#endif // OPENGLTEMPL_MATERIALPACKER_H
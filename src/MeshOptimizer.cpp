@@ -0,0 +1,283 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+// Forsyth's constants, the cache size is the one the scores assume and has
+// little to do with the hardware's
+constexpr int forsyth_cache_size = 32;
+constexpr float cache_decay_power = 1.5f;
+constexpr float last_triangle_score = 0.75f;
+constexpr float valence_boost_scale = 2.0f;
+constexpr float valence_boost_power = 0.5f;
+
+float vertex_score(int cache_position, unsigned remaining) {
+  if (remaining == 0) {
+    return -1.0f;
+  }
+  float score{0.0f};
+  if (cache_position >= 0) {
+    // The last triangle's vertices get a fixed score so the next triangle
+    // doesn't simply continue the strip backwards
+    score = cache_position < 3
+                ? last_triangle_score
+                : std::pow(1.0f - static_cast<float>(cache_position - 3) /
+                                      (forsyth_cache_size - 3),
+                           cache_decay_power);
+  }
+  // Vertices with few triangles left are worth finishing off
+  return score + valence_boost_scale *
+                     std::pow(static_cast<float>(remaining),
+                              -valence_boost_power);
+}
+
+// FIFO post-transform cache, a vertex is a hit while fewer than cache_size
+// misses happened since it was loaded
+class FifoCache {
+private:
+  std::vector<unsigned> loaded;
+  unsigned size;
+  unsigned clock;
+
+public:
+  FifoCache(size_t vertex_count, unsigned cache_size)
+      : loaded(vertex_count, 0), size(cache_size), clock(cache_size + 1) {}
+
+  // Whether the vertex had to be shaded
+  bool miss(GLuint index) {
+    if (clock - loaded[index] > size) {
+      loaded[index] = clock++;
+      return true;
+    }
+    return false;
+  }
+  void reset() { clock += size + 1; }
+};
+} // namespace
+
+VertexCacheStats analyze_vertex_cache(std::span<const GLuint> indices,
+                                      size_t vertex_count,
+                                      unsigned cache_size) {
+  if (indices.size() < 3) {
+    return {};
+  }
+  FifoCache cache{vertex_count, cache_size};
+  std::vector<bool> referenced(vertex_count);
+  size_t transformed{0}, unique{0};
+  for (GLuint index : indices) {
+    transformed += cache.miss(index) ? 1 : 0;
+    if (!referenced[index]) {
+      referenced[index] = true;
+      ++unique;
+    }
+  }
+  return {static_cast<float>(transformed) / (indices.size() / 3),
+          static_cast<float>(transformed) / unique};
+}
+
+void optimize_vertex_cache(std::span<GLuint> indices, size_t vertex_count) {
+  size_t triangle_count = indices.size() / 3;
+  if (triangle_count == 0) {
+    return;
+  }
+  // Triangles left to emit around every vertex, remaining[v] of them at the
+  // front of its adjacency range
+  std::vector<unsigned> remaining(vertex_count, 0);
+  for (GLuint index : indices) {
+    ++remaining[index];
+  }
+  std::vector<size_t> offsets(vertex_count + 1, 0);
+  std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+  std::vector<unsigned> adjacency(indices.size());
+  std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+  for (size_t t = 0; t < triangle_count; ++t) {
+    for (size_t k = 0; k < 3; ++k) {
+      adjacency[fill[indices[3 * t + k]]++] = static_cast<unsigned>(t);
+    }
+  }
+
+  std::vector<float> score(vertex_count);
+  for (size_t v = 0; v < vertex_count; ++v) {
+    score[v] = vertex_score(-1, remaining[v]);
+  }
+  std::vector<GLuint> source(indices.begin(), indices.end());
+  auto triangle_score = [&](unsigned t) {
+    return score[source[3 * t]] + score[source[3 * t + 1]] +
+           score[source[3 * t + 2]];
+  };
+  std::vector<bool> emitted(triangle_count);
+
+  std::vector<GLuint> cache, next_cache;
+  cache.reserve(forsyth_cache_size + 3);
+  next_cache.reserve(forsyth_cache_size + 3);
+  size_t cursor{0};
+  // Any triangle will do to start with
+  long best{0};
+  for (size_t output = 0; output < triangle_count; ++output) {
+    if (best < 0) {
+      // Nothing in the cache has triangles left, continue in input order
+      while (emitted[cursor]) {
+        ++cursor;
+      }
+      best = static_cast<long>(cursor);
+    }
+    emitted[best] = true;
+    const GLuint *triangle = &source[3 * best];
+    next_cache.assign(triangle, triangle + 3);
+    for (size_t k = 0; k < 3; ++k) {
+      GLuint v = triangle[k];
+      indices[3 * output + k] = v;
+      auto first = adjacency.begin() + static_cast<long>(offsets[v]);
+      auto last = first + remaining[v];
+      std::iter_swap(std::find(first, last, static_cast<unsigned>(best)),
+                     last - 1);
+      --remaining[v];
+    }
+    for (GLuint v : cache) {
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        next_cache.push_back(v);
+      }
+    }
+    std::swap(cache, next_cache);
+
+    // Rescore the cache (and whatever just fell out of it), the next
+    // triangle is the best one around a cached vertex
+    for (size_t i = 0; i < cache.size(); ++i) {
+      bool cached = i < forsyth_cache_size;
+      score[cache[i]] = vertex_score(cached ? static_cast<int>(i) : -1,
+                                     remaining[cache[i]]);
+    }
+    best = -1;
+    float best_score{-1.0f};
+    for (size_t i = 0; i < std::min<size_t>(cache.size(), forsyth_cache_size);
+         ++i) {
+      GLuint v = cache[i];
+      for (size_t j = offsets[v]; j < offsets[v] + remaining[v]; ++j) {
+        float candidate = triangle_score(adjacency[j]);
+        if (candidate > best_score) {
+          best_score = candidate;
+          best = adjacency[j];
+        }
+      }
+    }
+    cache.resize(std::min<size_t>(cache.size(), forsyth_cache_size));
+  }
+}
+
+void optimize_overdraw(std::span<GLuint> indices,
+                       std::span<const glm::vec3> positions, float threshold) {
+  size_t triangle_count = indices.size() / 3;
+  if (triangle_count < 2) {
+    return;
+  }
+  // Hard boundaries, where the cache order restarts with three misses
+  std::vector<size_t> hard{0};
+  FifoCache cache{positions.size(), 16};
+  for (size_t t = 0; t < triangle_count; ++t) {
+    int misses{0};
+    for (size_t k = 0; k < 3; ++k) {
+      misses += cache.miss(indices[3 * t + k]) ? 1 : 0;
+    }
+    if (misses == 3 && t > 0) {
+      hard.push_back(t);
+    }
+  }
+  hard.push_back(triangle_count);
+
+  // Soft boundaries inside those, wherever a cold cache has paid for itself
+  std::vector<size_t> clusters;
+  for (size_t h = 0; h + 1 < hard.size(); ++h) {
+    auto run_misses = [&](size_t begin, size_t end) {
+      cache.reset();
+      size_t misses{0};
+      for (size_t i = 3 * begin; i < 3 * end; ++i) {
+        misses += cache.miss(indices[i]) ? 1 : 0;
+      }
+      return misses;
+    };
+    float cluster_acmr = static_cast<float>(run_misses(hard[h], hard[h + 1])) /
+                         (hard[h + 1] - hard[h]);
+    size_t start = hard[h];
+    clusters.push_back(start);
+    cache.reset();
+    size_t misses{0};
+    for (size_t t = start; t + 1 < hard[h + 1]; ++t) {
+      for (size_t k = 0; k < 3; ++k) {
+        misses += cache.miss(indices[3 * t + k]) ? 1 : 0;
+      }
+      if (static_cast<float>(misses) / (t + 1 - start) <=
+          threshold * cluster_acmr) {
+        start = t + 1;
+        clusters.push_back(start);
+        cache.reset();
+        misses = 0;
+      }
+    }
+  }
+  clusters.push_back(triangle_count);
+
+  // Area weighted centroid and normal of every cluster
+  size_t cluster_count = clusters.size() - 1;
+  std::vector<glm::vec3> centroids(cluster_count), normals(cluster_count);
+  glm::vec3 mesh_centroid{0.0f};
+  float mesh_area{0.0f};
+  for (size_t c = 0; c < cluster_count; ++c) {
+    glm::vec3 centroid{0.0f}, normal{0.0f};
+    float area{0.0f};
+    for (size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+      glm::vec3 a = positions[indices[3 * t]];
+      glm::vec3 b = positions[indices[3 * t + 1]];
+      glm::vec3 d = positions[indices[3 * t + 2]];
+      glm::vec3 n = glm::cross(b - a, d - a);
+      float weight = glm::length(n);
+      centroid += (a + b + d) * (weight / 3.0f);
+      normal += n;
+      area += weight;
+    }
+    mesh_centroid += centroid;
+    mesh_area += area;
+    centroids[c] = area > 0 ? centroid / area : centroid;
+    normals[c] = normal;
+  }
+  if (mesh_area > 0) {
+    mesh_centroid = mesh_centroid / mesh_area;
+  }
+
+  // Outward facing clusters far from the center occlude the rest from most
+  // directions, draw them first
+  std::vector<float> keys(cluster_count);
+  for (size_t c = 0; c < cluster_count; ++c) {
+    float length = glm::length(normals[c]);
+    keys[c] = length > 0 ? glm::dot(centroids[c] - mesh_centroid, normals[c]) /
+                               length
+                         : 0.0f;
+  }
+  std::vector<size_t> order(cluster_count);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+  std::vector<GLuint> source(indices.begin(), indices.end());
+  size_t output{0};
+  for (size_t c : order) {
+    for (size_t i = 3 * clusters[c]; i < 3 * clusters[c + 1]; ++i) {
+      indices[output++] = source[i];
+    }
+  }
+}
+
+size_t optimize_vertex_fetch_remap(std::span<GLuint> indices,
+                                   size_t vertex_count,
+                                   std::vector<GLuint> &remap) {
+  remap.assign(vertex_count, ~0u);
+  GLuint next{0};
+  for (GLuint &index : indices) {
+    if (remap[index] == ~0u) {
+      remap[index] = next++;
+    }
+    index = remap[index];
+  }
+  return next;
+}
@@ -0,0 +1,124 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+void compute_bounds(MeshletMesh &mesh, Meshlet &meshlet,
+                    std::span<const glm::vec3> positions) {
+  auto vertex = [&](size_t i) {
+    return positions[mesh.vertices[meshlet.vertex_offset + i]];
+  };
+  glm::vec3 lo = vertex(0), hi = vertex(0);
+  for (size_t i = 1; i < meshlet.vertex_count; ++i) {
+    lo = glm::min(lo, vertex(i));
+    hi = glm::max(hi, vertex(i));
+  }
+  glm::vec3 center = (lo + hi) * 0.5f;
+  float radius{0.0f};
+  for (size_t i = 0; i < meshlet.vertex_count; ++i) {
+    radius = std::max(radius, glm::distance(center, vertex(i)));
+  }
+  meshlet.sphere = glm::vec4(center, radius);
+
+  std::vector<glm::vec3> normals;
+  glm::vec3 axis{0.0f};
+  for (size_t t = 0; t < meshlet.triangle_count; ++t) {
+    const uint8_t *local = &mesh.triangles[3 * (meshlet.triangle_offset + t)];
+    glm::vec3 a = vertex(local[0]);
+    glm::vec3 n = glm::cross(vertex(local[1]) - a, vertex(local[2]) - a);
+    float length = glm::length(n);
+    if (length > 0) {
+      normals.push_back(n / length);
+      axis += normals.back();
+    }
+  }
+  float axis_length = glm::length(axis);
+  meshlet.cone_axis = axis_length > 0 ? axis / axis_length : glm::vec3(0.0f);
+  meshlet.cone_cutoff = 1.0f;
+  if (axis_length == 0) {
+    return;
+  }
+  float min_dot{1.0f};
+  for (const glm::vec3 &n : normals) {
+    min_dot = std::min(min_dot, glm::dot(n, meshlet.cone_axis));
+  }
+  // Nearly hemispherical cones cull too rarely to bother
+  if (min_dot > 0.1f) {
+    meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+  }
+}
+} // namespace
+
+MeshletMesh build_meshlets(std::span<const GLuint> indices,
+                           std::span<const glm::vec3> positions,
+                           size_t max_vertices, size_t max_triangles) {
+  MeshletMesh mesh;
+  // Local indices are bytes
+  max_vertices = std::min<size_t>(max_vertices, 255);
+  // Where a vertex sits in the current meshlet, 0xFF if it isn't in it
+  std::vector<uint8_t> local(positions.size(), 0xFF);
+  Meshlet current{};
+
+  auto finish = [&]() {
+    if (current.triangle_count == 0) {
+      return;
+    }
+    compute_bounds(mesh, current, positions);
+    for (size_t i = 0; i < current.vertex_count; ++i) {
+      local[mesh.vertices[current.vertex_offset + i]] = 0xFF;
+    }
+    mesh.meshlets.push_back(current);
+    current = {};
+    current.vertex_offset = static_cast<GLuint>(mesh.vertices.size());
+    current.triangle_offset = static_cast<GLuint>(mesh.triangles.size() / 3);
+  };
+
+  for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+    size_t added{0};
+    for (size_t k = 0; k < 3; ++k) {
+      added += local[indices[t + k]] == 0xFF ? 1 : 0;
+    }
+    if (current.vertex_count + added > max_vertices ||
+        current.triangle_count + 1 > max_triangles) {
+      finish();
+    }
+    for (size_t k = 0; k < 3; ++k) {
+      GLuint index = indices[t + k];
+      if (local[index] == 0xFF) {
+        local[index] = static_cast<uint8_t>(current.vertex_count++);
+        mesh.vertices.push_back(index);
+      }
+      mesh.triangles.push_back(local[index]);
+    }
+    ++current.triangle_count;
+  }
+  finish();
+  return mesh;
+}
+
+bool backfacing(const Meshlet &meshlet, const glm::vec3 &camera_position) {
+  glm::vec3 center{meshlet.sphere.x, meshlet.sphere.y, meshlet.sphere.z};
+  glm::vec3 view = center - camera_position;
+  return glm::dot(view, meshlet.cone_axis) >=
+         meshlet.cone_cutoff * glm::length(view) + meshlet.sphere.w;
+}
+
+size_t cull_meshlets(const MeshletMesh &mesh, const Frustum &frustum,
+                     const glm::vec3 &camera_position,
+                     std::vector<GLuint> &visible) {
+  size_t kept{0};
+  for (const Meshlet &meshlet : mesh.meshlets) {
+    if (!frustum.intersects(meshlet.sphere) ||
+        backfacing(meshlet, camera_position)) {
+      continue;
+    }
+    ++kept;
+    const GLuint *vertices = &mesh.vertices[meshlet.vertex_offset];
+    const uint8_t *triangles = &mesh.triangles[3 * meshlet.triangle_offset];
+    for (size_t i = 0; i < 3 * meshlet.triangle_count; ++i) {
+      visible.push_back(vertices[triangles[i]]);
+    }
+  }
+  return kept;
+}
@@ -0,0 +1,52 @@
+#ifndef OPENGLTEMPL_MESHLETS_H
+#define OPENGLTEMPL_MESHLETS_H
+
+#include <glad/glad.h>
+
+#include "Frustum.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+// A small cluster of a mesh's triangles, with bounds to cull it by
+struct Meshlet {
+  // Ranges of MeshletMesh::vertices and of its triangles (3 bytes each)
+  GLuint vertex_offset, vertex_count;
+  GLuint triangle_offset, triangle_count;
+  glm::vec4 sphere; // center and radius, mesh space
+  // Every triangle normal is within the cone around axis. cone_cutoff is the
+  // sine of its half angle, 1 when the cone is too wide to ever cull.
+  glm::vec3 cone_axis;
+  float cone_cutoff;
+};
+
+struct MeshletMesh {
+  std::vector<Meshlet> meshlets;
+  // Mesh vertex indices, each meshlet's own little vertex list
+  std::vector<GLuint> vertices;
+  // Indices into the meshlet's vertex list
+  std::vector<uint8_t> triangles;
+};
+
+// Greedy in index order, run optimize_vertex_cache() first for tight
+// clusters. 64 vertices and 124 triangles fit mesh shader limits everywhere.
+MeshletMesh build_meshlets(std::span<const GLuint> indices,
+                           std::span<const glm::vec3> positions,
+                           size_t max_vertices = 64,
+                           size_t max_triangles = 124);
+
+// Whether every triangle faces away from camera_position
+bool backfacing(const Meshlet &meshlet, const glm::vec3 &camera_position);
+
+// Appends the triangles of every meshlet that is inside the frustum and not
+// back facing to visible, ready for glDrawElements. Both are in mesh space:
+// build the frustum from camera_matrix * model and move the camera by the
+// inverse model matrix. Returns the meshlets kept.
+size_t cull_meshlets(const MeshletMesh &mesh, const Frustum &frustum,
+                     const glm::vec3 &camera_position,
+                     std::vector<GLuint> &visible);
+
+#endif // OPENGLTEMPL_MESHLETS_H
@@ -0,0 +1,360 @@
+#include "MipGenerator.h"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OPENGLTEMPL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OPENGLTEMPL_SSE2
+#endif
+
+namespace {
+
+constexpr int rows_per_task = 16;
+
+struct Level {
+  int width, height;
+  std::vector<float> texels;
+};
+
+const std::array<float, 256> &to_linear() {
+  static const std::array<float, 256> table = [] {
+    std::array<float, 256> t{};
+    for (int i = 0; i < 256; ++i) {
+      float c = static_cast<float>(i) / 255;
+      t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    return t;
+  }();
+  return table;
+}
+
+// 12 bit linear in, 8 bit sRGB out
+const std::array<unsigned char, 4096> &to_srgb() {
+  static const std::array<unsigned char, 4096> table = [] {
+    std::array<unsigned char, 4096> t{};
+    for (int i = 0; i < 4096; ++i) {
+      float l = static_cast<float>(i) / 4095;
+      float c = l <= 0.0031308f ? l * 12.92f
+                                : 1.055f * std::pow(l, 1 / 2.4f) - 0.055f;
+      t[i] = static_cast<unsigned char>(std::lround(c * 255));
+    }
+    return t;
+  }();
+  return table;
+}
+
+// Alpha is always linear, a lone grey channel is colour
+int colour_channels(int channels, bool srgb) {
+  if (!srgb) {
+    return 0;
+  }
+  return channels == 2 || channels == 4 ? channels - 1 : channels;
+}
+
+template <typename F>
+void for_bands(ThreadPool *pool, int rows, F &&fn) {
+  auto band = [&](size_t task) {
+    int first = static_cast<int>(task) * rows_per_task;
+    fn(first, std::min(first + rows_per_task, rows));
+  };
+  size_t tasks = (rows + rows_per_task - 1) / rows_per_task;
+  if (pool) {
+    pool->parallel_for(tasks, band);
+  } else {
+    for (size_t i = 0; i < tasks; ++i) {
+      band(i);
+    }
+  }
+}
+
+void box_row(const float *r0, const float *r1, float *out, int src_width,
+             int dst_width, int channels) {
+  int x = 0;
+  // Vector paths need both source texels in range, odd widths finish below
+  int paired = src_width / 2;
+  if (channels == 4) {
+#if defined(OPENGLTEMPL_AVX2)
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    for (; x + 2 <= paired; x += 2) {
+      __m256 s0 = _mm256_add_ps(_mm256_loadu_ps(r0 + x * 8),
+                                _mm256_loadu_ps(r1 + x * 8));
+      __m256 s1 = _mm256_add_ps(_mm256_loadu_ps(r0 + x * 8 + 8),
+                                _mm256_loadu_ps(r1 + x * 8 + 8));
+      __m256 lo = _mm256_permute2f128_ps(s0, s1, 0x20);
+      __m256 hi = _mm256_permute2f128_ps(s0, s1, 0x31);
+      _mm256_storeu_ps(out + x * 4,
+                       _mm256_mul_ps(_mm256_add_ps(lo, hi), quarter));
+    }
+#elif defined(OPENGLTEMPL_SSE2)
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    for (; x < paired; ++x) {
+      __m128 a = _mm_add_ps(_mm_loadu_ps(r0 + x * 8), _mm_loadu_ps(r0 + x * 8 + 4));
+      __m128 b = _mm_add_ps(_mm_loadu_ps(r1 + x * 8), _mm_loadu_ps(r1 + x * 8 + 4));
+      _mm_storeu_ps(out + x * 4, _mm_mul_ps(_mm_add_ps(a, b), quarter));
+    }
+#endif
+  }
+  for (; x < dst_width; ++x) {
+    int x0 = std::min(x * 2, src_width - 1);
+    int x1 = std::min(x * 2 + 1, src_width - 1);
+    for (int c = 0; c < channels; ++c) {
+      out[x * channels + c] =
+          0.25f * (r0[x0 * channels + c] + r0[x1 * channels + c] +
+                   r1[x0 * channels + c] + r1[x1 * channels + c]);
+    }
+  }
+}
+
+Level box(const Level &src, int channels, ThreadPool *pool) {
+  Level dst{std::max(1, src.width / 2), std::max(1, src.height / 2), {}};
+  dst.texels.resize(static_cast<size_t>(dst.width) * dst.height * channels);
+  size_t src_pitch = static_cast<size_t>(src.width) * channels;
+  size_t dst_pitch = static_cast<size_t>(dst.width) * channels;
+  for_bands(pool, dst.height, [&](int first, int last) {
+    for (int y = first; y < last; ++y) {
+      int y0 = std::min(y * 2, src.height - 1);
+      int y1 = std::min(y * 2 + 1, src.height - 1);
+      box_row(src.texels.data() + y0 * src_pitch,
+              src.texels.data() + y1 * src_pitch,
+              dst.texels.data() + y * dst_pitch, src.width, dst.width,
+              channels);
+    }
+  });
+  return dst;
+}
+
+// Windowed sinc for a 2:1 reduction, six taps centred between two texels
+const std::array<float, 6> &kaiser_weights() {
+  static const std::array<float, 6> weights = [] {
+    auto bessel_i0 = [](double x) {
+      double sum = 1, term = 1;
+      for (int k = 1; k < 16; ++k) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+      }
+      return sum;
+    };
+    constexpr double alpha = 4, width = 3, pi = 3.14159265358979323846;
+    std::array<float, 6> w{};
+    double total = 0;
+    for (int i = 0; i < 6; ++i) {
+      double d = i - 2.5;
+      double x = pi * d / 2;
+      double sinc = std::sin(x) / x;
+      double r = d / width;
+      double window = bessel_i0(alpha * std::sqrt(1 - r * r)) / bessel_i0(alpha);
+      w[i] = static_cast<float>(sinc * window);
+      total += w[i];
+    }
+    for (float &v : w) {
+      v = static_cast<float>(v / total);
+    }
+    return w;
+  }();
+  return weights;
+}
+
+Level kaiser(const Level &src, int channels, ThreadPool *pool) {
+  const std::array<float, 6> &w = kaiser_weights();
+  Level dst{std::max(1, src.width / 2), std::max(1, src.height / 2), {}};
+  // Horizontal pass keeps the source height
+  std::vector<float> half(static_cast<size_t>(dst.width) * src.height *
+                          channels);
+  for_bands(pool, src.height, [&](int first, int last) {
+    for (int y = first; y < last; ++y) {
+      const float *row = src.texels.data() +
+                         static_cast<size_t>(y) * src.width * channels;
+      float *out = half.data() + static_cast<size_t>(y) * dst.width * channels;
+      for (int x = 0; x < dst.width; ++x) {
+        for (int c = 0; c < channels; ++c) {
+          float sum{0};
+          for (int t = 0; t < 6; ++t) {
+            int sx = std::clamp(x * 2 - 2 + t, 0, src.width - 1);
+            sum += w[t] * row[sx * channels + c];
+          }
+          out[x * channels + c] = sum;
+        }
+      }
+    }
+  });
+  dst.texels.resize(static_cast<size_t>(dst.width) * dst.height * channels);
+  size_t pitch = static_cast<size_t>(dst.width) * channels;
+  for_bands(pool, dst.height, [&](int first, int last) {
+    for (int y = first; y < last; ++y) {
+      float *out = dst.texels.data() + y * pitch;
+      for (size_t i = 0; i < pitch; ++i) {
+        float sum{0};
+        for (int t = 0; t < 6; ++t) {
+          int sy = std::clamp(y * 2 - 2 + t, 0, src.height - 1);
+          sum += w[t] * half[sy * pitch + i];
+        }
+        // Negative lobes can undershoot, LDR levels clamp the top in encode()
+        out[i] = std::max(sum, 0.0f);
+      }
+    }
+  });
+  return dst;
+}
+
+// count values starting on a texel, colour channels into linear light
+void decode_row(const unsigned char *in, size_t count, int channels,
+                int colour, float *out) {
+  const std::array<float, 256> &linear = to_linear();
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = static_cast<int>(i % channels) < colour
+                 ? linear[in[i]]
+                 : static_cast<float>(in[i]) / 255;
+  }
+}
+
+void encode_row(const float *in, size_t count, int channels, int colour,
+                unsigned char *out) {
+  const std::array<unsigned char, 4096> &srgb = to_srgb();
+  for (size_t i = 0; i < count; ++i) {
+    float v = std::clamp(in[i], 0.0f, 1.0f);
+    out[i] = static_cast<int>(i % channels) < colour
+                 ? srgb[std::lround(v * 4095)]
+                 : static_cast<unsigned char>(std::lround(v * 255));
+  }
+}
+
+// Level 0 of the image as floats, colour channels in linear light
+Level decode(const Image &image, int colour, ThreadPool *pool) {
+  const int channels = image.channels;
+  const size_t pitch = static_cast<size_t>(image.width) * channels;
+  Level level{image.width, image.height, {}};
+  level.texels.resize(image.pixels.size());
+  for_bands(pool, image.height, [&](int first, int last) {
+    for (int y = first; y < last; ++y) {
+      decode_row(image.pixels.data() + y * pitch, pitch, channels, colour,
+                 level.texels.data() + y * pitch);
+    }
+  });
+  return level;
+}
+
+void encode(const Level &level, int channels, int colour,
+            std::vector<unsigned char> &out, ThreadPool *pool) {
+  const size_t pitch = static_cast<size_t>(level.width) * channels;
+  out.resize(level.texels.size());
+  for_bands(pool, level.height, [&](int first, int last) {
+    for (int y = first; y < last; ++y) {
+      encode_row(level.texels.data() + y * pitch, pitch, channels, colour,
+                 out.data() + y * pitch);
+    }
+  });
+}
+
+} // namespace
+
+void generate_mips(Image &image, bool srgb, MipFilter filter,
+                   ThreadPool *pool) {
+  image.mips.clear();
+  if (image.empty()) {
+    return;
+  }
+  const int channels = image.channels;
+  const int colour = colour_channels(channels, srgb);
+  Level level = decode(image, colour, pool);
+  while (level.width > 1 || level.height > 1) {
+    level = filter == MipFilter::KAISER ? kaiser(level, channels, pool)
+                                        : box(level, channels, pool);
+    encode(level, channels, colour, image.mips.emplace_back(), pool);
+  }
+}
+
+void generate_mips(HdrImage &image, MipFilter filter, ThreadPool *pool) {
+  image.mips.clear();
+  if (image.empty()) {
+    return;
+  }
+  constexpr int channels = HdrImage::channels;
+  Level level{image.width, image.height, image.pixels};
+  while (level.width > 1 || level.height > 1) {
+    level = filter == MipFilter::KAISER ? kaiser(level, channels, pool)
+                                        : box(level, channels, pool);
+    image.mips.push_back(level.texels);
+  }
+}
+
+int reduction_levels(int width, int height, TextureQuality quality,
+                     int max_dimension) {
+  int levels = static_cast<int>(quality);
+  if (max_dimension > 0) {
+    while (std::max(width >> levels, height >> levels) > max_dimension) {
+      ++levels;
+    }
+  }
+  // Never below a single texel on the short side
+  while (levels > 0 && std::min(width >> levels, height >> levels) < 1) {
+    --levels;
+  }
+  return levels;
+}
+
+void downsample(Image &image, int levels, bool srgb, ThreadPool *pool) {
+  if (image.empty() || levels <= 0) {
+    return;
+  }
+  image.mips.clear();
+  const int channels = image.channels;
+  const int colour = colour_channels(channels, srgb);
+  // Every level down to the result, halving stops at a single texel
+  std::vector<std::pair<int, int>> sizes{{image.width, image.height}};
+  while (static_cast<int>(sizes.size()) <= levels &&
+         (sizes.back().first > 1 || sizes.back().second > 1)) {
+    sizes.emplace_back(std::max(1, sizes.back().first / 2),
+                       std::max(1, sizes.back().second / 2));
+  }
+  const int depth = static_cast<int>(sizes.size()) - 1;
+  if (depth == 0) {
+    return;
+  }
+  const auto [width, height] = sizes.back();
+  const size_t src_pitch = static_cast<size_t>(image.width) * channels;
+  const size_t dst_pitch = static_cast<size_t>(width) * channels;
+  std::vector<unsigned char> pixels(dst_pitch * height);
+  // Each output row pulls its source rows through the levels, so only two
+  // float rows per level are alive per band instead of the whole image.
+  for_bands(pool, height, [&](int first, int last) {
+    std::vector<std::vector<float>> rows(static_cast<size_t>(depth) * 2);
+    for (int k = 0; k < depth; ++k) {
+      rows[k * 2].resize(static_cast<size_t>(sizes[k].first) * channels);
+      rows[k * 2 + 1].resize(rows[k * 2].size());
+    }
+    std::vector<float> out(dst_pitch);
+    // Row y of level k into dst, same clamping at odd edges as box()
+    auto reduce = [&](auto &self, int k, int y, float *dst) -> void {
+      if (k == 0) {
+        decode_row(image.pixels.data() + y * src_pitch, src_pitch, channels,
+                   colour, dst);
+        return;
+      }
+      const auto [src_width, src_height] = sizes[k - 1];
+      int y0 = std::min(y * 2, src_height - 1);
+      int y1 = std::min(y * 2 + 1, src_height - 1);
+      float *r0 = rows[(k - 1) * 2].data();
+      float *r1 = y1 == y0 ? r0 : rows[(k - 1) * 2 + 1].data();
+      self(self, k - 1, y0, r0);
+      if (r1 != r0) {
+        self(self, k - 1, y1, r1);
+      }
+      box_row(r0, r1, dst, src_width, sizes[k].first, channels);
+    };
+    for (int y = first; y < last; ++y) {
+      reduce(reduce, depth, y, out.data());
+      encode_row(out.data(), dst_pitch, channels, colour,
+                 pixels.data() + y * dst_pitch);
+    }
+  });
+  image.width = width;
+  image.height = height;
+  image.pixels = std::move(pixels);
+}
@@ -0,0 +1,33 @@
+#ifndef OPENGLTEMPL_MIPGENERATOR_H
+#define OPENGLTEMPL_MIPGENERATOR_H
+
+#include "HdrImage.h"
+#include "Image.h"
+#include "ThreadPool.h"
+
+enum class MipFilter { BOX, KAISER };
+
+// Load time resolution tiers, each step halves both dimensions
+enum class TextureQuality { FULL, HALF, QUARTER };
+
+// Builds levels 1.. of the mip chain into image.mips, replacing any that are
+// there. Filtering happens in linear light: with srgb the colour channels
+// (never alpha) are decoded first and encoded again per level. Each level is
+// split into row bands across the pool when one is given.
+void generate_mips(Image &image, bool srgb, MipFilter filter = MipFilter::BOX,
+                   ThreadPool *pool = nullptr);
+
+// Same for HDR images, which are linear already.
+void generate_mips(HdrImage &image, MipFilter filter = MipFilter::BOX,
+                   ThreadPool *pool = nullptr);
+
+// How many 2:1 reductions take a width x height image down to the tier and,
+// when max_dimension is non zero, to no more than max_dimension on either side.
+int reduction_levels(int width, int height, TextureQuality quality,
+                     int max_dimension = 0);
+
+// Replaces level 0 with the image reduced levels times by the box filter
+// (same linear light handling as generate_mips()) and drops any mips.
+void downsample(Image &image, int levels, bool srgb, ThreadPool *pool = nullptr);
+
+#endif // OPENGLTEMPL_MIPGENERATOR_H
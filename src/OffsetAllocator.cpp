@@ -0,0 +1,205 @@
+#include "OffsetAllocator.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+constexpr uint32_t mantissa_bits = 3;
+constexpr uint32_t mantissa_value = 1 << mantissa_bits;
+constexpr uint32_t mantissa_mask = mantissa_value - 1;
+
+// Small float encoding of a size, bins grow by 1/8 of their power of two
+uint32_t bin_round_down(uint32_t size) {
+  if (size < mantissa_value) {
+    return size;
+  }
+  uint32_t shift = static_cast<uint32_t>(std::bit_width(size)) - 1 -
+                   mantissa_bits;
+  return (shift + 1) << mantissa_bits | ((size >> shift) & mantissa_mask);
+}
+
+// Smallest bin whose every range is at least size
+uint32_t bin_round_up(uint32_t size) {
+  uint32_t bin = bin_round_down(size);
+  if (size >= mantissa_value) {
+    uint32_t shift = static_cast<uint32_t>(std::bit_width(size)) - 1 -
+                     mantissa_bits;
+    if (size & ((1u << shift) - 1)) {
+      ++bin; // a mantissa carry moves on to the next exponent, which is right
+    }
+  }
+  return bin;
+}
+
+uint32_t lowest_bit_from(uint32_t bits, uint32_t first) {
+  uint32_t masked = first >= 32 ? 0 : bits & (~0u << first);
+  return masked ? static_cast<uint32_t>(std::countr_zero(masked)) : 32;
+}
+} // namespace
+
+OffsetAllocator::OffsetAllocator(uint32_t size) : capacity(size) { reset(); }
+
+void OffsetAllocator::reset() {
+  top_bitmap = 0;
+  leaf_bitmaps.fill(0);
+  bin_heads.fill(none);
+  nodes.clear();
+  spare_nodes.clear();
+  free_bytes_ = 0;
+  if (capacity > 0) {
+    insert_free(new_node(0, capacity, none, none));
+  }
+}
+
+uint32_t OffsetAllocator::new_node(uint32_t offset, uint32_t size,
+                                   uint32_t prev, uint32_t next) {
+  uint32_t index;
+  if (!spare_nodes.empty()) {
+    index = spare_nodes.back();
+    spare_nodes.pop_back();
+  } else {
+    index = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+  }
+  nodes[index] = {offset, size, none, none, prev, next, false};
+  return index;
+}
+
+void OffsetAllocator::insert_free(uint32_t index) {
+  Node &node = nodes[index];
+  uint32_t bin = bin_round_down(node.size);
+  node.used = false;
+  node.bin_prev = none;
+  node.bin_next = bin_heads[bin];
+  if (node.bin_next != none) {
+    nodes[node.bin_next].bin_prev = index;
+  }
+  bin_heads[bin] = index;
+  top_bitmap |= 1u << (bin / 8);
+  leaf_bitmaps[bin / 8] |= static_cast<uint8_t>(1u << (bin % 8));
+  free_bytes_ += node.size;
+}
+
+void OffsetAllocator::remove_free(uint32_t index) {
+  Node &node = nodes[index];
+  uint32_t bin = bin_round_down(node.size);
+  if (node.bin_prev != none) {
+    nodes[node.bin_prev].bin_next = node.bin_next;
+  } else {
+    bin_heads[bin] = node.bin_next;
+    if (node.bin_next == none) {
+      leaf_bitmaps[bin / 8] &= static_cast<uint8_t>(~(1u << (bin % 8)));
+      if (leaf_bitmaps[bin / 8] == 0) {
+        top_bitmap &= ~(1u << (bin / 8));
+      }
+    }
+  }
+  if (node.bin_next != none) {
+    nodes[node.bin_next].bin_prev = node.bin_prev;
+  }
+  free_bytes_ -= node.size;
+}
+
+uint32_t OffsetAllocator::find_bin(uint32_t first) const {
+  uint32_t top = first / 8;
+  if (top >= bin_count / 8) {
+    return none;
+  }
+  uint32_t leaf = lowest_bit_from(leaf_bitmaps[top], first % 8);
+  if (leaf < 8) {
+    return top * 8 + leaf;
+  }
+  top = lowest_bit_from(top_bitmap, top + 1);
+  if (top == 32) {
+    return none;
+  }
+  return top * 8 + static_cast<uint32_t>(std::countr_zero(leaf_bitmaps[top]));
+}
+
+OffsetAllocator::Allocation OffsetAllocator::allocate(uint32_t size,
+                                                      uint32_t alignment) {
+  size = std::max(size, 1u);
+  alignment = std::max(alignment, 1u);
+  uint64_t needed = static_cast<uint64_t>(size) + alignment - 1;
+  if (needed > free_bytes_) {
+    return {};
+  }
+  uint32_t bin = find_bin(bin_round_up(static_cast<uint32_t>(needed)));
+  if (bin == none) {
+    return {};
+  }
+  uint32_t index = bin_heads[bin];
+  remove_free(index);
+
+  // Free neighbours are always merged, so both new remainders border used
+  // ranges (or the ends) and need no merging
+  uint32_t offset = nodes[index].offset;
+  uint32_t lead = (alignment - offset % alignment) % alignment;
+  if (lead) {
+    uint32_t before = new_node(offset, lead, nodes[index].prev, index);
+    if (nodes[before].prev != none) {
+      nodes[nodes[before].prev].next = before;
+    }
+    nodes[index].prev = before;
+    nodes[index].offset += lead;
+    nodes[index].size -= lead;
+    insert_free(before);
+  }
+  if (nodes[index].size > size) {
+    uint32_t after = new_node(nodes[index].offset + size,
+                              nodes[index].size - size, index,
+                              nodes[index].next);
+    if (nodes[after].next != none) {
+      nodes[nodes[after].next].prev = after;
+    }
+    nodes[index].next = after;
+    nodes[index].size = size;
+    insert_free(after);
+  }
+  nodes[index].used = true;
+  return {nodes[index].offset, index};
+}
+
+void OffsetAllocator::free(Allocation allocation) {
+  if (!allocation.valid() || !nodes[allocation.node].used) {
+    return;
+  }
+  uint32_t index = allocation.node;
+  uint32_t prev = nodes[index].prev;
+  if (prev != none && !nodes[prev].used) {
+    remove_free(prev);
+    nodes[index].offset = nodes[prev].offset;
+    nodes[index].size += nodes[prev].size;
+    nodes[index].prev = nodes[prev].prev;
+    if (nodes[index].prev != none) {
+      nodes[nodes[index].prev].next = index;
+    }
+    spare_nodes.push_back(prev);
+  }
+  uint32_t next = nodes[index].next;
+  if (next != none && !nodes[next].used) {
+    remove_free(next);
+    nodes[index].size += nodes[next].size;
+    nodes[index].next = nodes[next].next;
+    if (nodes[index].next != none) {
+      nodes[nodes[index].next].prev = index;
+    }
+    spare_nodes.push_back(next);
+  }
+  insert_free(index);
+}
+
+uint32_t OffsetAllocator::largest_free() const {
+  if (!top_bitmap) {
+    return 0;
+  }
+  uint32_t top = 31 - static_cast<uint32_t>(std::countl_zero(top_bitmap));
+  uint32_t bin = top * 8 + 7 -
+                 static_cast<uint32_t>(std::countl_zero(
+                     static_cast<uint32_t>(leaf_bitmaps[top]) << 24));
+  uint32_t largest{0};
+  for (uint32_t i = bin_heads[bin]; i != none; i = nodes[i].bin_next) {
+    largest = std::max(largest, nodes[i].size);
+  }
+  return largest;
+}
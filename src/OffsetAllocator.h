@@ -0,0 +1,68 @@
+#ifndef OPENGLTEMPL_OFFSETALLOCATOR_H
+#define OPENGLTEMPL_OFFSETALLOCATOR_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Hands out ranges of some linear resource (a GL buffer) without touching it.
+// TLSF style: free ranges live in 256 size bins (5 bit exponent, 3 bit
+// mantissa) found through two bitmaps, so allocate() and free() are O(1).
+// Freed ranges merge with free neighbours straight away.
+class OffsetAllocator {
+public:
+  static constexpr uint32_t no_space = 0xFFFFFFFF;
+
+  struct Allocation {
+    uint32_t offset{no_space};
+    uint32_t node{no_space};
+
+    bool valid() const { return offset != no_space; }
+  };
+
+private:
+  static constexpr uint32_t none = 0xFFFFFFFF;
+  static constexpr uint32_t bin_count = 256;
+
+  struct Node {
+    uint32_t offset{}, size{};
+    // Free list of the node's bin
+    uint32_t bin_prev{none}, bin_next{none};
+    // Neighbours in address order
+    uint32_t prev{none}, next{none};
+    bool used{false};
+  };
+
+  uint32_t capacity;
+  uint32_t free_bytes_{0};
+  uint32_t top_bitmap{0};
+  std::array<uint8_t, bin_count / 8> leaf_bitmaps{};
+  std::array<uint32_t, bin_count> bin_heads;
+  std::vector<Node> nodes;
+  std::vector<uint32_t> spare_nodes;
+
+  uint32_t new_node(uint32_t offset, uint32_t size, uint32_t prev,
+                    uint32_t next);
+  void insert_free(uint32_t index);
+  void remove_free(uint32_t index);
+  uint32_t find_bin(uint32_t first) const;
+
+public:
+  explicit OffsetAllocator(uint32_t size);
+
+  // Alignment needn't be a power of two, so vertex strides work as is.
+  // Returns an invalid Allocation when no free range is big enough.
+  Allocation allocate(uint32_t size, uint32_t alignment = 1);
+  void free(Allocation allocation);
+  // Everything free again
+  void reset();
+
+  uint32_t size(Allocation allocation) const {
+    return nodes[allocation.node].size;
+  }
+  uint32_t free_bytes() const { return free_bytes_; }
+  uint32_t largest_free() const;
+  uint32_t total_bytes() const { return capacity; }
+};
+
+#endif // OPENGLTEMPL_OFFSETALLOCATOR_H
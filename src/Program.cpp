@@ -16,8 +16,9 @@ GLuint Program::create_shader(const std::string &shader_source, GLenum shader_ty
     glGetShaderiv(shader, GL_COMPILE_STATUS, &diagnostic.success);
     if (!diagnostic.success) {
         glGetShaderInfoLog(shader, 512, nullptr, diagnostic.infoLog);
-        // Should Only be Vert or Frag Shader passed in
-        std::string_view shader_type_str{(shader_type == GL_VERTEX_SHADER) ? "VERTEX" : "FRAGMENT"};
+        std::string_view shader_type_str{(shader_type == GL_VERTEX_SHADER)   ? "VERTEX"
+                                         : (shader_type == GL_COMPUTE_SHADER) ? "COMPUTE"
+                                                                              : "FRAGMENT"};
         std::cout << "ERROR::SHADER::" << shader_type_str << "::COMPILATION_FAILED\n" << diagnostic.infoLog
                   << std::endl;
     }
@@ -31,14 +32,48 @@ Program::Program(GLFWwindow *p_window, const std::string &vert_source, const std
     id = glCreateProgram();
     glAttachShader(id, vertex);
     glAttachShader(id, fragment);
+    link();
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+}
+
+Program::Program(const std::string &compute_source) : window(nullptr) {
+    auto compute = create_shader(compute_source, GL_COMPUTE_SHADER);
+    id = glCreateProgram();
+    glAttachShader(id, compute);
+    link();
+    glDeleteShader(compute);
+}
+
+void Program::link() {
     glLinkProgram(id);
     glGetProgramiv(id, GL_LINK_STATUS, &diagnostic.success);
     if (!diagnostic.success) {
         glGetProgramInfoLog(id, 512, nullptr, diagnostic.infoLog);
         std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << diagnostic.infoLog << std::endl;
     }
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+}
+
+std::string Program::with_defines(const std::string &source, std::span<const std::string> defines) {
+    std::string lines;
+    for (const std::string &define: defines) {
+        lines += "#define " + define + "\n";
+    }
+    return with_snippet(source, lines);
+}
+
+std::string Program::with_snippet(const std::string &source, const std::string &snippet) {
+    std::string lines{snippet};
+    // #version has to stay the first directive
+    size_t version = source.find("#version");
+    size_t insert = version == std::string::npos ? 0 : source.find('\n', version);
+    insert = insert == std::string::npos ? source.size() : insert + 1;
+    if (insert == source.size() && version != std::string::npos) {
+        lines.insert(0, "\n");
+    }
+    std::string variant{source};
+    variant.insert(insert, lines);
+    return variant;
 }
 
 Program::operator GLuint() const { return id; }
@@ -8,6 +8,7 @@
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <span>
 #include <string>
 
 struct Diagnostic {
@@ -22,9 +23,18 @@ private:
     Diagnostic diagnostic{};
 
     GLuint create_shader(const std::string &shader_source, GLenum shader_type);
+    void link();
 
 public:
     Program(GLFWwindow *p_window, const std::string &vert_source, const std::string &frag_source);
+    // Compute only program, dispatch with glDispatchCompute after glUseProgram
+    explicit Program(const std::string &compute_source);
+
+    // Source with a #define for each name inserted right after its #version line, used to build
+    // shader variants from one source
+    static std::string with_defines(const std::string &source, std::span<const std::string> defines);
+    // Same for a block of GLSL, like the glsl helpers other classes provide
+    static std::string with_snippet(const std::string &source, const std::string &snippet);
 
     operator GLuint() const;
 };
@@ -0,0 +1,106 @@
+#include "ResidencyManager.h"
+
+#include <algorithm>
+
+ResidencyManager::ResidencyManager(TextureLoader &texture_loader,
+                                   size_t budget_bytes, int max_dropped)
+    : loader(texture_loader), budget(budget_bytes),
+      max_dropped_mips(max_dropped) {}
+
+ResidencyManager::~ResidencyManager() {
+  for (Texture *texture : textures) {
+    texture->track(nullptr, nullptr);
+  }
+}
+
+void ResidencyManager::track(Texture &texture) {
+  texture.track(this, &frame_);
+  textures.push_back(&texture);
+}
+
+void ResidencyManager::untrack(Texture *texture) {
+  std::erase(textures, texture);
+  restoring.erase(texture);
+}
+
+size_t ResidencyManager::resident_bytes() const {
+  size_t bytes{0};
+  for (const Texture *texture : textures) {
+    bytes += texture->gpu_bytes();
+  }
+  return bytes;
+}
+
+void ResidencyManager::reload(Texture &texture) {
+  loader.load(texture, texture.source_path, texture.source_compressed,
+              texture.packed_paths);
+}
+
+void ResidencyManager::end_frame() {
+  // Bring back evicted textures that were asked for this frame. One already
+  // coming back keeps its request until that load lands.
+  for (Texture *texture : textures) {
+    if (texture->wanted() && texture->state == Texture::TextureState::EVICTED &&
+        !texture->in_flight()) {
+      texture->clear_wanted();
+      reload(*texture);
+    }
+  }
+  std::erase_if(restoring, [](Texture *texture) {
+    return texture->dropped_mips() == 0 ||
+           texture->state != Texture::TextureState::READY;
+  });
+
+  size_t resident = resident_bytes();
+
+  // Least recently used first
+  std::vector<Texture *> order = textures;
+  std::sort(order.begin(), order.end(), [](Texture *a, Texture *b) {
+    return a->last_used() < b->last_used();
+  });
+
+  for (Texture *texture : order) {
+    if (resident <= budget) {
+      break;
+    }
+    // Never pull something out from under the frame that just used it
+    // nor from under a load or upload that is about to replace its storage
+    if (texture->last_used() >= frame_ ||
+        texture->state != Texture::TextureState::READY ||
+        texture->in_flight()) {
+      continue;
+    }
+    while (resident > budget && texture->dropped_mips() < max_dropped_mips) {
+      size_t freed = texture->drop_top_mip();
+      if (freed == 0) {
+        break;
+      }
+      resident -= freed;
+    }
+    if (resident > budget && !texture->source_path.empty()) {
+      resident -= texture->evict();
+      restoring.erase(texture);
+    }
+  }
+
+  // With headroom, restore reduced textures that are still in use, most
+  // recently used first. A full chain is roughly 4x per dropped level.
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    Texture *texture = *it;
+    if (texture->dropped_mips() == 0 || texture->source_path.empty() ||
+        texture->last_used() + 1 < frame_ || restoring.contains(texture) ||
+        texture->in_flight()) {
+      continue;
+    }
+    size_t current = texture->gpu_bytes();
+    size_t full = current << (2 * texture->dropped_mips());
+    if (resident - current + full > budget - budget / 8) {
+      break;
+    }
+    resident += full - current;
+    restoring.insert(texture);
+    reload(*texture);
+  }
+
+  ++frame_;
+}
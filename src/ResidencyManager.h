@@ -0,0 +1,51 @@
+#ifndef OPENGLTEMPL_RESIDENCYMANAGER_H
+#define OPENGLTEMPL_RESIDENCYMANAGER_H
+
+#include "Texture.h"
+#include "TextureLoader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+// Keeps the GPU memory of tracked textures under a budget. Texture::bind
+// stamps each texture with the current frame, and when the budget is exceeded
+// the least recently used textures first lose their top mip levels and are
+// then evicted outright. Evicted textures come back through the loader the
+// next time something binds them. Reduced ones are restored once there is
+// headroom again.
+class ResidencyManager final : public TextureRegistry {
+private:
+  TextureLoader &loader;
+  size_t budget;
+  int max_dropped_mips;
+  uint64_t frame_{1};
+  std::vector<Texture *> textures;
+  // Reduced textures with a full reload in flight
+  std::unordered_set<Texture *> restoring;
+
+  void reload(Texture &texture);
+
+public:
+  explicit ResidencyManager(TextureLoader &texture_loader, size_t budget_bytes,
+                            int max_dropped = 2);
+  ~ResidencyManager();
+
+  ResidencyManager(const ResidencyManager &) = delete;
+  ResidencyManager &operator=(const ResidencyManager &) = delete;
+
+  // Only textures with a source_path can be evicted, others just drop mips
+  void track(Texture &texture);
+  void untrack(Texture *texture) override;
+
+  // Call once a frame after drawing.
+  void end_frame();
+
+  size_t resident_bytes() const;
+  size_t budget_bytes() const { return budget; }
+  void set_budget(size_t budget_bytes) { budget = budget_bytes; }
+  uint64_t frame() const { return frame_; }
+};
+
+#endif // OPENGLTEMPL_RESIDENCYMANAGER_H
@@ -0,0 +1,69 @@
+#include "StreamBuffer.h"
+
+#include <iostream>
+
+namespace {
+constexpr GLbitfield map_flags =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+StreamBuffer::StreamBuffer(size_t bytes_per_frame, size_t frames_in_flight)
+    : region_size(bytes_per_frame) {
+  GLint alignment;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  uniform_alignment_ = static_cast<size_t>(alignment);
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  storage_alignment_ = static_cast<size_t>(alignment);
+
+  glCreateBuffers(1, &id_);
+  glNamedBufferStorage(id_, region_size * frames_in_flight, nullptr,
+                       map_flags);
+  mapped = static_cast<unsigned char *>(glMapNamedBufferRange(
+      id_, 0, region_size * frames_in_flight, map_flags));
+  for (size_t i = 0; i < frames_in_flight; ++i) {
+    regions.push_back({i * region_size});
+  }
+}
+
+StreamBuffer::~StreamBuffer() {
+  for (Region &region : regions) {
+    if (region.fence) {
+      glDeleteSync(region.fence);
+    }
+  }
+  glUnmapNamedBuffer(id_);
+  glDeleteBuffers(1, &id_);
+}
+
+void StreamBuffer::begin_frame() {
+  Region &region = regions[current];
+  head = 0;
+  if (!region.fence) {
+    return;
+  }
+  while (glClientWaitSync(region.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                          1'000'000) == GL_TIMEOUT_EXPIRED) {
+  }
+  glDeleteSync(region.fence);
+  region.fence = nullptr;
+}
+
+void StreamBuffer::end_frame() {
+  regions[current].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  current = (current + 1) % regions.size();
+}
+
+StreamBuffer::Slice StreamBuffer::allocate(size_t size, size_t alignment) {
+  // Regions start at multiples of region_size, align the absolute offset
+  size_t base = regions[current].offset;
+  size_t offset = (base + head + alignment - 1) / alignment * alignment;
+  if (offset + size > base + region_size) {
+    std::cout << "ERROR::STREAM_BUFFER::OUT_OF_SPACE\n"
+              << size << " bytes, " << region_size - head << " free"
+              << std::endl;
+    return {};
+  }
+  head = offset + size - base;
+  return {mapped + offset, static_cast<GLintptr>(offset),
+          static_cast<GLsizeiptr>(size)};
+}
@@ -0,0 +1,101 @@
+#ifndef OPENGLTEMPL_STREAMBUFFER_H
+#define OPENGLTEMPL_STREAMBUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <vector>
+
+// Per-frame data (uniform blocks, instance data, dynamic vertices) written
+// straight into a persistently mapped, coherent buffer, no glBufferSubData or
+// glUniform copies in between. Like UploadScheduler the ring has a region per
+// frame in flight guarded by a fence, so this frame's writes never land on
+// data the GPU may still be reading.
+class StreamBuffer {
+private:
+  struct Region {
+    size_t offset;
+    GLsync fence{};
+  };
+
+  GLuint id_{};
+  unsigned char *mapped{};
+  size_t region_size;
+  std::vector<Region> regions;
+  size_t current{0};
+  size_t head{0};
+  size_t uniform_alignment_, storage_alignment_;
+
+public:
+  // Where an allocation landed, data points into the mapping and offset is
+  // what glBindBufferRange and glVertexArrayVertexBuffer want.
+  struct Slice {
+    void *data{};
+    GLintptr offset{};
+    GLsizeiptr size{};
+
+    bool valid() const { return data != nullptr; }
+  };
+
+  // frames_in_flight regions of bytes_per_frame each are allocated up front
+  explicit StreamBuffer(size_t bytes_per_frame = 4 << 20,
+                        size_t frames_in_flight = 3);
+  ~StreamBuffer();
+
+  StreamBuffer(const StreamBuffer &) = delete;
+  StreamBuffer &operator=(const StreamBuffer &) = delete;
+
+  // Waits for the region this frame reuses, call before the first allocate()
+  void begin_frame();
+  // Fences everything written since begin_frame(), call after the last draw
+  // that reads it.
+  void end_frame();
+
+  // Alignment needn't be a power of two. Returns an invalid Slice once the
+  // frame's region is full.
+  Slice allocate(size_t size, size_t alignment = 16);
+
+  template <typename T>
+  Slice write(std::span<const T> data, size_t alignment = alignof(T)) {
+    Slice slice = allocate(data.size_bytes(), alignment);
+    if (slice.valid()) {
+      std::memcpy(slice.data, data.data(), data.size_bytes());
+    }
+    return slice;
+  }
+  template <typename T>
+  Slice write(const T &value, size_t alignment = alignof(T)) {
+    return write(std::span<const T>{&value, 1}, alignment);
+  }
+
+  // T has to mirror the std140 block
+  template <typename T> Slice uniform(const T &block) {
+    return write(block, uniform_alignment_);
+  }
+  template <typename T> Slice storage(std::span<const T> data) {
+    return write(data, storage_alignment_);
+  }
+
+  void bind_uniform(GLuint binding, const Slice &slice) const {
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, id_, slice.offset,
+                      slice.size);
+  }
+  void bind_storage(GLuint binding, const Slice &slice) const {
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, id_, slice.offset,
+                      slice.size);
+  }
+  // Dynamic vertices or per-instance attributes for a VAO binding point
+  void bind_vertices(GLuint vao, GLuint binding, const Slice &slice,
+                     GLsizei stride) const {
+    glVertexArrayVertexBuffer(vao, binding, id_, slice.offset, stride);
+  }
+
+  size_t used_bytes() const { return head; }
+  size_t capacity() const { return region_size; }
+
+  operator GLuint() const { return id_; }
+};
+
+#endif // OPENGLTEMPL_STREAMBUFFER_H
@@ -7,37 +7,429 @@
 
 #include <glad/glad.h>
 #include <stb_image.h>
+
+#include "BlockCompression.h"
+#include "Image.h"
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "TextureFile.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
 #include <string>
+#include <vector>
+
+class Texture;
+
+// Gets told when a tracked texture goes away, see ResidencyManager.
+class TextureRegistry {
+public:
+  virtual void untrack(Texture *texture) = 0;
+
+protected:
+  ~TextureRegistry() = default;
+};
 
 class Texture {
 private:
-  int width, height, numColChannel;
-  GLuint id_;
+  int width{}, height{}, numColChannel{};
+  GLuint id_{};
+  // Storage being streamed in while id_ keeps being sampled
+  GLuint incoming_{};
+  // Loads queued on a TextureLoader that haven't handed their result over yet
+  int pending_loads_{0};
+  GLenum internal_{};
+  GLsizei levels_{};
+  int dropped_mips_{0};
+
+  TextureRegistry *registry_{};
+  const uint64_t *clock_{};
+  mutable uint64_t last_used_{0};
+  mutable bool wanted_{false};
+
+  GLuint create(GLsizei levels, GLenum internal) {
+    internal_ = internal;
+    levels_ = levels;
+    GLuint tex;
+    glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+
+    glTextureParameteri(tex, GL_TEXTURE_MIN_FILTER,
+                        levels > 1 ? GL_NEAREST_MIPMAP_LINEAR : GL_NEAREST);
+    glTextureParameteri(tex, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(tex, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(tex, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    glTextureStorage2D(tex, levels, internal, width, height);
+    swizzle(tex);
+    return tex;
+  }
+
+  // Swaps in freshly filled storage, always a full resolution chain
+  void replace(GLuint tex) {
+    glDeleteTextures(1, &id_);
+    id_ = tex;
+    dropped_mips_ = 0;
+    wanted_ = false;
+    state = TextureState::READY;
+  }
 
 public:
-  enum class TextureType { DIFFUSE, SPECULAR };
+  enum class TextureType { DIFFUSE, SPECULAR, NORMAL };
+  enum class TextureState { PENDING, READY, FAILED, EVICTED };
   TextureType type;
+  TextureState state{TextureState::PENDING};
+  // Where the contents came from, lets evicted textures be loaded again
+  std::string source_path;
+  // Scalar maps packed into spare channels, see pack_material()
+  std::vector<std::string> packed_paths;
+  bool source_compressed{false};
+
+  // Pending texture, samples the placeholder until upload() is called. Used by
+  // TextureLoader so decoding can happen off the render thread.
+  explicit Texture(TextureType tex_type) : type(tex_type) {}
 
   explicit Texture(const std::string &path, GLenum format,
-                   TextureType tex_type)     : type(tex_type) {
-    stbi_uc *bytes = stbi_load(path.c_str(), &width, &height, &numColChannel, 0);
-    glCreateTextures(GL_TEXTURE_2D, 1, &id_);
-
-    glTextureParameteri(id_, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTextureParameteri(id_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTextureParameteri(id_, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTextureParameteri(id_, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    glTextureStorage2D(id_, 1, GL_RGBA8, width, height);
-    glTextureSubImage2D(id_, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE,
-                        bytes);
+                   TextureType tex_type,
+                   TextureQuality quality = TextureQuality::FULL,
+                   int max_dimension = 0)     : type(tex_type) {
+    MappedFile source{path};
+    int w{}, h{};
+    Image image;
+    bool srgb = type == TextureType::DIFFUSE;
+    if (source.valid() && image_size(source.bytes(), w, h)) {
+      image = decode_image(source.bytes(),
+                           reduction_levels(w, h, quality, max_dimension),
+                           srgb);
+    }
+    if (image.empty()) {
+      std::cout << "ERROR::TEXTURE::LOAD_FAILED\n" << path << std::endl;
+    }
+    generate_mips(image, srgb);
+    upload(image, format);
+  };
+
+  // HDR source (.hdr and friends) stored packed at 32 bits a texel
+  explicit Texture(const std::string &path, HdrFormat format,
+                   TextureType tex_type)
+      : type(tex_type) {
+    MappedFile source{path};
+    HdrImage image = source.valid() ? HdrImage::load(source.bytes()) : HdrImage{};
+    if (image.empty()) {
+      std::cout << "ERROR::TEXTURE::LOAD_FAILED\n" << path << std::endl;
+    }
+    generate_mips(image);
+    upload(pack(image, format));
+  }
+
+  Texture(const Texture &) = delete;
+  Texture &operator=(const Texture &) = delete;
+
+  virtual ~Texture() {
+    if (registry_) {
+      registry_->untrack(this);
+    }
+    glDeleteTextures(1, &id_);
+    glDeleteTextures(1, &incoming_);
+  } ;
+
+  // Creates storage without any pixels and returns its name. The contents are
+  // filled in later (e.g. by UploadScheduler) and finish_upload() swaps it in,
+  // a texture that is already READY keeps sampling its old storage meanwhile.
+  // internal defaults to the 8 bit format for channels.
+  GLuint allocate(int w, int h, int channels, GLsizei levels = 1,
+                  GLenum internal = GL_NONE) {
+    width = w;
+    height = h;
+    numColChannel = channels;
+    glDeleteTextures(1, &incoming_);
+    incoming_ = create(levels, internal == GL_NONE ? internal_format(channels)
+                                                   : internal);
+    return incoming_;
+  }
+
+  // Nothing to swap in unless allocate() ran since the last one
+  void finish_upload() {
+    if (!incoming_) {
+      return;
+    }
+    replace(incoming_);
+    incoming_ = 0;
+  }
+
+  // Uploads every level the image carries, see generate_mips(). Must be called
+  // on the GL thread.
+  void upload(const Image &image, GLenum format) {
+    if (image.empty()) {
+      state = TextureState::FAILED;
+      return;
+    }
+    auto levels = static_cast<GLsizei>(image.level_count());
+    width = image.width;
+    height = image.height;
+    numColChannel = image.channels;
+    GLuint tex = create(levels, internal_format(image.channels));
+    // Small levels of RGB images aren't 4 byte aligned
+    GLint alignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (GLsizei level = 0; level < levels; ++level) {
+      glTextureSubImage2D(tex, level, 0, 0, image.level_width(level),
+                          image.level_height(level), format, GL_UNSIGNED_BYTE,
+                          image.level(level).data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
     // RGB for jpeg, RGBA for png
-    glGenerateTextureMipmap(id_);
-    stbi_image_free(bytes);
+    replace(tex);
+  }
+
+  // Uploads a pre-compressed mip chain, no mipmap generation needed.
+  void upload(const CompressedImage &image, int channels) {
+    if (image.empty()) {
+      state = TextureState::FAILED;
+      return;
+    }
+    width = image.width;
+    height = image.height;
+    numColChannel = channels;
+    GLenum format = ::internal_format(image.format);
+    auto levels = static_cast<GLsizei>(image.levels.size());
+    GLuint tex = create(levels, format);
+    for (GLsizei level = 0; level < levels; ++level) {
+      glCompressedTextureSubImage2D(
+          tex, level, 0, 0, image.level_width(level), image.level_height(level),
+          format, static_cast<GLsizei>(image.levels[level].size()),
+          image.levels[level].data());
+    }
+    replace(tex);
+  }
+
+  // Uploads a packed HDR mip chain, see pack().
+  void upload(const PackedHdrImage &image) {
+    if (image.empty()) {
+      state = TextureState::FAILED;
+      return;
+    }
+    width = image.width;
+    height = image.height;
+    numColChannel = 3;
+    auto levels = static_cast<GLsizei>(image.levels.size());
+    GLuint tex = create(levels, ::internal_format(image.format));
+    for (GLsizei level = 0; level < levels; ++level) {
+      glTextureSubImage2D(tex, level, 0, 0, image.level_width(level),
+                          image.level_height(level), GL_RGB,
+                          pixel_type(image.format), image.levels[level].data());
+    }
+    replace(tex);
+  }
+
+  // Uploads every level of a cached texture straight from its mapping.
+  void upload(const TextureFile &file) {
+    if (!file.valid()) {
+      state = TextureState::FAILED;
+      return;
+    }
+    const TextureFileHeader &header = file.header();
+    width = static_cast<int>(header.width);
+    height = static_cast<int>(header.height);
+    numColChannel = static_cast<int>(header.channels);
+    auto levels = static_cast<GLsizei>(file.level_count());
+    GLuint tex = create(levels, header.internal_format);
+    GLint alignment;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (GLsizei level = 0; level < levels; ++level) {
+      std::span<const unsigned char> data = file.level(level);
+      if (file.compressed()) {
+        glCompressedTextureSubImage2D(
+            tex, level, 0, 0, file.level_width(level), file.level_height(level),
+            header.internal_format, static_cast<GLsizei>(data.size()),
+            data.data());
+      } else {
+        glTextureSubImage2D(tex, level, 0, 0, file.level_width(level),
+                            file.level_height(level), header.pixel_format,
+                            GL_UNSIGNED_BYTE, data.data());
+      }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    replace(tex);
+  }
+
+  void bind(GLuint unit) const {
+    if (clock_) {
+      last_used_ = *clock_;
+      wanted_ = wanted_ || state == TextureState::EVICTED;
+    }
+    glBindTextureUnit(unit, state == TextureState::READY ? id_ : placeholder());
   };
 
-  virtual ~Texture() { glDeleteTextures(1, &id_); } ;
-  void bind(GLuint unit) const { glBindTextureUnit(unit, id_); };
+  bool ready() const { return state == TextureState::READY; }
+
+  // TextureLoader brackets a load with these, from queueing it to handing
+  // the result to the uploader. The upload itself is in flight until
+  // finish_upload().
+  void begin_load() { ++pending_loads_; }
+  void end_load() { pending_loads_ = std::max(0, pending_loads_ - 1); }
+  bool in_flight() const { return pending_loads_ > 0 || incoming_ != 0; }
+
+  // Residency bookkeeping, bind() stamps the texture with *clock
+  void track(TextureRegistry *registry, const uint64_t *clock) {
+    registry_ = registry;
+    clock_ = clock;
+  }
+  uint64_t last_used() const { return last_used_; }
+  // Bound while evicted since the last reload request
+  bool wanted() const { return wanted_; }
+  void clear_wanted() { wanted_ = false; }
+  int dropped_mips() const { return dropped_mips_; }
+  GLsizei levels() const { return levels_; }
+
+  size_t gpu_bytes() const {
+    if (state != TextureState::READY) {
+      return 0;
+    }
+    return storage_bytes(internal_, width, height, levels_);
+  }
+
+  // Halves the resolution by copying levels 1.. into new storage on the GPU,
+  // returns the bytes freed. Reloading the source brings the top level back.
+  size_t drop_top_mip() {
+    if (state != TextureState::READY || levels_ <= 1 || incoming_) {
+      return 0;
+    }
+    size_t before = gpu_bytes();
+    int old_width = width, old_height = height;
+    width = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+    GLuint tex = create(levels_ - 1, internal_);
+    for (GLsizei level = 0; level < levels_; ++level) {
+      glCopyImageSubData(id_, GL_TEXTURE_2D, level + 1, 0, 0, 0, tex,
+                         GL_TEXTURE_2D, level, 0, 0, 0,
+                         std::max(1, old_width >> (level + 1)),
+                         std::max(1, old_height >> (level + 1)), 1);
+    }
+    glDeleteTextures(1, &id_);
+    id_ = tex;
+    ++dropped_mips_;
+    return before - gpu_bytes();
+  }
+
+  // Frees the storage, bind() falls back to the placeholder until reloaded.
+  // Frees nothing while a load or upload is in flight.
+  size_t evict() {
+    if (in_flight()) {
+      return 0;
+    }
+    size_t freed = gpu_bytes();
+    glDeleteTextures(1, &id_);
+    id_ = 0;
+    state = TextureState::EVICTED;
+    return freed;
+  }
+
+  static size_t storage_bytes(GLenum internal, int w, int h, GLsizei levels) {
+    size_t bytes{0};
+    for (GLsizei level = 0; level < levels; ++level) {
+      size_t lw = std::max(1, w >> level), lh = std::max(1, h >> level);
+      size_t blocks = ((lw + 3) / 4) * ((lh + 3) / 4);
+      switch (internal) {
+      case GL_R8:
+        bytes += lw * lh;
+        break;
+      case GL_RG8:
+        bytes += lw * lh * 2;
+        break;
+      case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+      case GL_COMPRESSED_RED_RGTC1:
+        bytes += blocks * 8;
+        break;
+      case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+      case GL_COMPRESSED_RG_RGTC2:
+      case GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT:
+      case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        bytes += blocks * 16;
+        break;
+      default:
+        // RGB8 is padded to four bytes by every driver we run on, RGB9_E5
+        // and R11F_G11F_B10F are four bytes anyway
+        bytes += lw * lh * 4;
+        break;
+      }
+    }
+    return bytes;
+  }
+
+  // 1x1 white texture bound in place of anything not yet uploaded
+  static GLuint placeholder() {
+    static GLuint id = [] {
+      GLuint tex;
+      const unsigned char white[]{255, 255, 255, 255};
+      glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+      glTextureStorage2D(tex, 1, GL_RGBA8, 1, 1);
+      glTextureSubImage2D(tex, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+      return tex;
+    }();
+    return id;
+  }
+
+  // Single channel diffuse maps are greyscale, not red
+  void swizzle(GLuint tex) const {
+    if (type == TextureType::DIFFUSE && numColChannel == 1) {
+      const GLint grey[]{GL_RED, GL_RED, GL_RED, GL_ONE};
+      glTextureParameteriv(tex, GL_TEXTURE_SWIZZLE_RGBA, grey);
+    }
+  }
+
+  static GLenum internal_format(int channels) {
+    switch (channels) {
+    case 1:
+      return GL_R8;
+    case 2:
+      return GL_RG8;
+    case 3:
+      return GL_RGB8;
+    default:
+      return GL_RGBA8;
+    }
+  }
+
+  // Normals keep X/Y and rebuild Z in the shader, scalar maps get one channel
+  // unless several were packed together. RGB falls back to BC7 without S3TC.
+  static BlockFormat block_format(int channels, TextureType tex_type) {
+    switch (tex_type) {
+    case TextureType::NORMAL:
+      return BlockFormat::BC5;
+    case TextureType::SPECULAR:
+      return channels == 1 ? BlockFormat::BC4 : BlockFormat::BC7;
+    case TextureType::DIFFUSE:
+      break;
+    }
+    switch (channels) {
+    case 1:
+      return BlockFormat::BC4;
+    case 2:
+      return BlockFormat::BC5;
+    case 3:
+      return s3tc_supported() ? BlockFormat::BC1 : BlockFormat::BC7;
+    default:
+      return BlockFormat::BC7;
+    }
+  }
+
+  static GLenum pixel_format(int channels) {
+    switch (channels) {
+    case 1:
+      return GL_RED;
+    case 2:
+      return GL_RG;
+    case 3:
+      return GL_RGB;
+    default:
+      return GL_RGBA;
+    }
+  }
 
   operator GLuint() const { return id_; };
 };
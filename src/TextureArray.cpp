@@ -0,0 +1,91 @@
+#include "TextureArray.h"
+
+#include <algorithm>
+
+TextureArray::TextureArray(GLenum internal, int w, int h, GLsizei levels,
+                           GLsizei layers)
+    : internal_(internal), width(w), height(h), levels_(levels),
+      capacity(layers) {
+  glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &id_);
+  glTextureParameteri(id_, GL_TEXTURE_MIN_FILTER,
+                      levels > 1 ? GL_NEAREST_MIPMAP_LINEAR : GL_NEAREST);
+  glTextureParameteri(id_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTextureParameteri(id_, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTextureParameteri(id_, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTextureStorage3D(id_, levels, internal, width, height, layers);
+}
+
+TextureArray::~TextureArray() { glDeleteTextures(1, &id_); }
+
+bool TextureArray::accepts(int w, int h, GLenum internal) const {
+  return count < capacity && w == width && h == height && internal == internal_;
+}
+
+GLint TextureArray::add(const Image &image, GLenum internal, GLenum format) {
+  if (image.empty() || !accepts(image.width, image.height, internal)) {
+    return -1;
+  }
+  auto levels = std::min(levels_, static_cast<GLsizei>(image.level_count()));
+  GLint alignment;
+  glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (GLsizei level = 0; level < levels; ++level) {
+    glTextureSubImage3D(id_, level, 0, 0, count, image.level_width(level),
+                        image.level_height(level), 1, format, GL_UNSIGNED_BYTE,
+                        image.level(level).data());
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+  return count++;
+}
+
+GLint TextureArray::add(const CompressedImage &image) {
+  GLenum format = ::internal_format(image.format);
+  if (image.empty() || !accepts(image.width, image.height, format)) {
+    return -1;
+  }
+  auto levels = std::min(levels_, static_cast<GLsizei>(image.levels.size()));
+  for (GLsizei level = 0; level < levels; ++level) {
+    glCompressedTextureSubImage3D(
+        id_, level, 0, 0, count, image.level_width(level),
+        image.level_height(level), 1, format,
+        static_cast<GLsizei>(image.levels[level].size()),
+        image.levels[level].data());
+  }
+  return count++;
+}
+
+GLint TextureArray::add(const TextureFile &file) {
+  if (!file.valid()) {
+    return -1;
+  }
+  uint32_t first = 0;
+  while (first < file.level_count() && file.level_width(first) > width) {
+    ++first;
+  }
+  GLenum format = file.compressed() ? file.header().internal_format : internal_;
+  if (first == file.level_count() ||
+      !accepts(file.level_width(first), file.level_height(first), format)) {
+    return -1;
+  }
+  auto levels =
+      std::min(levels_, static_cast<GLsizei>(file.level_count() - first));
+  GLint alignment;
+  glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (GLsizei level = 0; level < levels; ++level) {
+    std::span<const unsigned char> data = file.level(first + level);
+    int w = file.level_width(first + level);
+    int h = file.level_height(first + level);
+    if (file.compressed()) {
+      glCompressedTextureSubImage3D(id_, level, 0, 0, count, w, h, 1, format,
+                                    static_cast<GLsizei>(data.size()),
+                                    data.data());
+    } else {
+      glTextureSubImage3D(id_, level, 0, 0, count, w, h, 1,
+                          file.header().pixel_format, GL_UNSIGNED_BYTE,
+                          data.data());
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+  return count++;
+}
@@ -0,0 +1,50 @@
+#ifndef OPENGLTEMPL_TEXTUREARRAY_H
+#define OPENGLTEMPL_TEXTUREARRAY_H
+
+#include <glad/glad.h>
+
+#include "BlockCompression.h"
+#include "Image.h"
+#include "TextureFile.h"
+
+#include <cstddef>
+
+// Same sized, same format materials as layers of one GL_TEXTURE_2D_ARRAY.
+// Bind it once and pick the material per draw with a layer index, passed as
+// DrawData::material, instead of binding a texture per draw.
+class TextureArray {
+private:
+  GLuint id_{};
+  GLenum internal_;
+  int width, height;
+  GLsizei levels_, capacity;
+  GLsizei count{0};
+
+public:
+  TextureArray(GLenum internal, int w, int h, GLsizei levels, GLsizei layers);
+  ~TextureArray();
+
+  TextureArray(const TextureArray &) = delete;
+  TextureArray &operator=(const TextureArray &) = delete;
+
+  // Whether an image of this size and internal format fits in a free layer
+  bool accepts(int w, int h, GLenum internal) const;
+
+  // Upload every level the image carries (missing ones stay undefined) into
+  // the next layer and return it, -1 if the image doesn't fit.
+  GLint add(const Image &image, GLenum internal, GLenum format);
+  GLint add(const CompressedImage &image);
+  // A cache entry from its first level of the array's size on, so larger
+  // sources are reduced by skipping levels. Uncompressed entries are
+  // converted to the array's format, compressed ones have to match it.
+  GLint add(const TextureFile &file);
+
+  void bind(GLuint unit) const { glBindTextureUnit(unit, id_); }
+
+  GLsizei layers() const { return count; }
+  GLenum internal_format() const { return internal_; }
+
+  operator GLuint() const { return id_; }
+};
+
+#endif // OPENGLTEMPL_TEXTUREARRAY_H
@@ -0,0 +1,103 @@
+#include "TextureCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+bool commit(const TextureCache &cache, uint64_t content_hash, uint32_t variant,
+            const TextureFileHeader &header,
+            std::span<const std::span<const unsigned char>> levels) {
+  std::filesystem::path target = cache.entry(content_hash, variant);
+  std::filesystem::path temp = target;
+  temp += "." + std::to_string(std::hash<std::thread::id>{}(
+                    std::this_thread::get_id())) + ".tmp";
+  if (!TextureFile::write(temp.string(), header, levels)) {
+    return false;
+  }
+  std::error_code error;
+  std::filesystem::rename(temp, target, error);
+  if (error) {
+    std::filesystem::remove(temp, error);
+    return false;
+  }
+  return true;
+}
+} // namespace
+
+TextureCache::TextureCache(std::filesystem::path dir)
+    : directory(std::move(dir)) {
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+}
+
+uint64_t TextureCache::hash(std::span<const unsigned char> bytes) {
+  // Word at a time multiply/xorshift mix, plenty for a cache key and running
+  // at memory speed unlike byte wise FNV.
+  constexpr uint64_t prime = 0x9E3779B97F4A7C15ull;
+  uint64_t h = bytes.size() * prime;
+  size_t i = 0;
+  for (; i + 8 <= bytes.size(); i += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes.data() + i, 8);
+    h = (h ^ (word * prime)) * 0xFF51AFD7ED558CCDull;
+    h ^= h >> 32;
+  }
+  uint64_t tail{0};
+  std::memcpy(&tail, bytes.data() + i, bytes.size() - i);
+  h = (h ^ (tail * prime)) * 0xC4CEB9FE1A85EC53ull;
+  return h ^ (h >> 29);
+}
+
+uint64_t TextureCache::hash(std::span<const MappedFile> sources) {
+  if (sources.size() == 1) {
+    return hash(sources.front().bytes());
+  }
+  uint64_t seed{0};
+  for (const MappedFile &source : sources) {
+    uint64_t h = source.valid() ? hash(source.bytes()) : 0;
+    seed = (seed ^ h) * 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2);
+  }
+  return seed;
+}
+
+std::filesystem::path TextureCache::entry(uint64_t content_hash,
+                                          uint32_t variant) const {
+  char name[40];
+  std::snprintf(name, sizeof(name), "%016llx-%u.tex",
+                static_cast<unsigned long long>(content_hash), variant);
+  return directory / name;
+}
+
+TextureFile TextureCache::find(uint64_t content_hash, uint32_t variant) const {
+  return TextureFile{MappedFile{entry(content_hash, variant).string()}};
+}
+
+bool TextureCache::store(uint64_t content_hash, uint32_t variant,
+                         const Image &image) const {
+  TextureFileHeader header{};
+  header.internal_format = Texture::internal_format(image.channels);
+  header.pixel_format = Texture::pixel_format(image.channels);
+  header.width = image.width;
+  header.height = image.height;
+  header.channels = image.channels;
+  std::vector<std::span<const unsigned char>> levels;
+  for (size_t level = 0; level < image.level_count(); ++level) {
+    levels.push_back(image.level(level));
+  }
+  return commit(*this, content_hash, variant, header, levels);
+}
+
+bool TextureCache::store(uint64_t content_hash, uint32_t variant,
+                         const CompressedImage &image, int channels) const {
+  TextureFileHeader header{};
+  header.internal_format = internal_format(image.format);
+  header.width = image.width;
+  header.height = image.height;
+  header.channels = channels;
+  std::vector<std::span<const unsigned char>> levels(image.levels.begin(),
+                                                     image.levels.end());
+  return commit(*this, content_hash, variant, header, levels);
+}
@@ -0,0 +1,62 @@
+#ifndef OPENGLTEMPL_TEXTURECACHE_H
+#define OPENGLTEMPL_TEXTURECACHE_H
+
+#include "BlockCompression.h"
+#include "Image.h"
+#include "Texture.h"
+#include "TextureFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+// On disk cache of GPU ready textures keyed by the hash of the source file's
+// contents. The first load writes an entry, later runs map it and skip
+// decoding entirely. Entries are written to a temporary name and renamed, so
+// concurrent workers never see half written files.
+class TextureCache {
+private:
+  std::filesystem::path directory;
+
+public:
+  explicit TextureCache(std::filesystem::path dir = "cache");
+
+  static uint64_t hash(std::span<const unsigned char> bytes);
+  // Key of a texture built from several sources (order matters, missing ones
+  // count too), the plain content hash for a single one
+  static uint64_t hash(std::span<const MappedFile> sources);
+
+  // The variant tells apart different processing of the same source, e.g. a
+  // raw and a block compressed entry.
+  std::filesystem::path entry(uint64_t content_hash, uint32_t variant) const;
+
+  // Bump whenever an encoder, the mip filter or the material packer changes
+  // its output, older entries then stop matching
+  static constexpr uint32_t encoder_version = 2;
+
+  // The texture type always counts: it picks the block format, and
+  // uncompressed DIFFUSE mips are filtered in linear light while the other
+  // types are filtered as stored. S3TC support, the requested resolution
+  // tier and encoder_version are part of the key too.
+  static uint32_t variant(Texture::TextureType type, bool compress,
+                          TextureQuality quality = TextureQuality::FULL,
+                          int max_dimension = 0) {
+    auto processing = static_cast<uint32_t>(type) | (compress ? 1u : 0u) << 2;
+    uint32_t fallback = compress && !s3tc_supported() ? 1 : 0;
+    auto dimension =
+        static_cast<uint32_t>(std::clamp(max_dimension, 0, (1 << 18) - 1));
+    return processing | static_cast<uint32_t>(quality) << 3 | fallback << 5 |
+           dimension << 6 | encoder_version << 24;
+  }
+
+  // Invalid TextureFile when there is no usable entry
+  TextureFile find(uint64_t content_hash, uint32_t variant) const;
+
+  bool store(uint64_t content_hash, uint32_t variant,
+             const Image &image) const;
+  bool store(uint64_t content_hash, uint32_t variant,
+             const CompressedImage &image, int channels) const;
+};
+
+#endif // OPENGLTEMPL_TEXTURECACHE_H
@@ -0,0 +1,162 @@
+#ifndef OPENGLTEMPL_TEXTUREFILE_H
+#define OPENGLTEMPL_TEXTUREFILE_H
+
+#include "BlockCompression.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+// GPU ready texture container in the spirit of KTX2: a fixed header, a level
+// index and then every mip level, 16 byte aligned, exactly as GL wants it.
+// Read through a mapping so uploads come straight out of the page cache.
+struct TextureFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t internal_format; // sized or block compressed GL format
+  uint32_t pixel_format;    // GL_RED..GL_RGBA, 0 when block compressed
+  uint32_t width, height, channels, level_count;
+  uint32_t reserved;
+};
+
+struct TextureFileLevel {
+  uint64_t offset, size;
+};
+
+class TextureFile {
+private:
+  MappedFile file;
+  const TextureFileHeader *header_{};
+  const TextureFileLevel *levels_{};
+
+public:
+  static constexpr char magic[8]{'O', 'G', 'L', 'T', 'E', 'X', '\r', '\n'};
+  static constexpr uint32_t version = 2;
+
+  TextureFile() = default;
+
+  explicit TextureFile(MappedFile mapped) : file(std::move(mapped)) {
+    if (file.size() < sizeof(TextureFileHeader)) {
+      return;
+    }
+    auto header = reinterpret_cast<const TextureFileHeader *>(file.data());
+    size_t index_end = sizeof(TextureFileHeader) +
+                       header->level_count * sizeof(TextureFileLevel);
+    if (std::memcmp(header->magic, magic, sizeof(magic)) != 0 ||
+        header->version != version || header->level_count == 0 ||
+        file.size() < index_end) {
+      return;
+    }
+    if (header->width == 0 || header->height == 0 || header->channels == 0 ||
+        header->channels > 4 ||
+        header->level_count > std::bit_width(std::max(header->width,
+                                                      header->height))) {
+      return;
+    }
+    auto levels = reinterpret_cast<const TextureFileLevel *>(
+        file.data() + sizeof(TextureFileHeader));
+    for (uint32_t i = 0; i < header->level_count; ++i) {
+      if (levels[i].offset > file.size() ||
+          levels[i].size > file.size() - levels[i].offset) {
+        return; // truncated
+      }
+      // A short level would have GL read past the mapping
+      uint64_t width = std::max(1u, header->width >> i);
+      uint64_t height = std::max(1u, header->height >> i);
+      uint64_t expected =
+          header->pixel_format == 0
+              ? (width + 3) / 4 * ((height + 3) / 4) *
+                    block_bytes(header->internal_format)
+              : width * height * header->channels;
+      if (levels[i].size != expected) {
+        return;
+      }
+    }
+    header_ = header;
+    levels_ = levels;
+  }
+
+  // The mapping moves, so the moved-from file must stop pointing into it
+  TextureFile(TextureFile &&other) noexcept
+      : file(std::move(other.file)),
+        header_(std::exchange(other.header_, nullptr)),
+        levels_(std::exchange(other.levels_, nullptr)) {}
+
+  TextureFile &operator=(TextureFile &&other) noexcept {
+    if (this != &other) {
+      file = std::move(other.file);
+      header_ = std::exchange(other.header_, nullptr);
+      levels_ = std::exchange(other.levels_, nullptr);
+    }
+    return *this;
+  }
+
+  bool valid() const { return header_ != nullptr; }
+  bool compressed() const { return header_->pixel_format == 0; }
+  const TextureFileHeader &header() const { return *header_; }
+  uint32_t level_count() const { return header_->level_count; }
+  int level_width(size_t level) const {
+    return std::max(1, static_cast<int>(header_->width >> level));
+  }
+  int level_height(size_t level) const {
+    return std::max(1, static_cast<int>(header_->height >> level));
+  }
+  // Bytes of a 4x4 block when compressed
+  size_t block_bytes() const { return block_bytes(header_->internal_format); }
+  static size_t block_bytes(uint32_t internal_format) {
+    switch (internal_format) {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RED_RGTC1:
+      return 8;
+    default:
+      return 16;
+    }
+  }
+  std::span<const unsigned char> level(size_t i) const {
+    return {file.data() + levels_[i].offset, levels_[i].size};
+  }
+
+  // header.magic, version and level_count are filled in here
+  static bool write(const std::string &path, TextureFileHeader header,
+                    std::span<const std::span<const unsigned char>> levels) {
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.level_count = static_cast<uint32_t>(levels.size());
+
+    auto align = [](uint64_t v) { return (v + 15) & ~uint64_t{15}; };
+    std::vector<TextureFileLevel> index(levels.size());
+    uint64_t offset = align(sizeof(TextureFileHeader) +
+                            levels.size() * sizeof(TextureFileLevel));
+    for (size_t i = 0; i < levels.size(); ++i) {
+      index[i] = {offset, levels[i].size()};
+      offset = align(offset + levels[i].size());
+    }
+
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    if (!out) {
+      return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(index.data()),
+              static_cast<std::streamsize>(index.size() *
+                                           sizeof(TextureFileLevel)));
+    for (size_t i = 0; i < levels.size(); ++i) {
+      const char zeros[16]{};
+      out.write(zeros, static_cast<std::streamsize>(
+                           index[i].offset - static_cast<uint64_t>(out.tellp())));
+      out.write(reinterpret_cast<const char *>(levels[i].data()),
+                static_cast<std::streamsize>(levels[i].size()));
+    }
+    return static_cast<bool>(out);
+  }
+};
+
+#endif // OPENGLTEMPL_TEXTUREFILE_H
@@ -0,0 +1,245 @@
+#include "TextureLoader.h"
+
+#include "ImageDecoder.h"
+
+#include <iostream>
+#include <thread>
+
+TextureLoader::TextureLoader(UploadScheduler *upload_scheduler,
+                             TextureCache *texture_cache, size_t workers,
+                             size_t queue_capacity)
+    : uploader(upload_scheduler), cache(texture_cache),
+      finished(queue_capacity), pool(workers) {
+  // Before any worker picks a block format
+  query_s3tc_support();
+}
+
+TextureLoader::~TextureLoader() { stopping = true; }
+
+void TextureLoader::load(Texture &texture, std::string path, bool compress,
+                         std::vector<std::string> packed_paths) {
+  // A READY texture being reloaded keeps drawing its current contents
+  if (texture.state != Texture::TextureState::READY) {
+    texture.state = Texture::TextureState::PENDING;
+  }
+  texture.source_path = path;
+  texture.packed_paths = std::move(packed_paths);
+  texture.source_compressed = compress;
+  texture.begin_load();
+  ++in_flight;
+  TextureQuality tier = quality;
+  int max_size = max_dimension;
+  pool.submit([this, &texture, compress, tier, max_size,
+               packed = texture.packed_paths,
+               path = std::move(path)]() mutable {
+    Decoded decoded{&texture, std::move(path), {}, {}, {}, {}, 0, {}};
+    decode(decoded, texture.type, packed, compress, tier, max_size);
+    push(std::move(decoded));
+  });
+}
+
+void TextureLoader::load_file(Texture::TextureType type, std::string path,
+                              std::function<void(TextureFile)> done,
+                              std::vector<std::string> packed_paths) {
+  ++in_flight;
+  TextureQuality tier = quality;
+  int max_size = max_dimension;
+  pool.submit([this, type, tier, max_size, packed = std::move(packed_paths),
+               path = std::move(path), done = std::move(done)]() mutable {
+    Decoded decoded{nullptr, std::move(path), {}, {}, {}, {}, 0,
+                    std::move(done)};
+    decode(decoded, type, packed, false, tier, max_size);
+    push(std::move(decoded));
+  });
+}
+
+void TextureLoader::decode(Decoded &decoded, Texture::TextureType type,
+                           const std::vector<std::string> &packed,
+                           bool compress, TextureQuality tier, int max_size) {
+  // A packed material reads every one of its maps
+  std::vector<MappedFile> sources;
+  if (packed.empty()) {
+    sources.emplace_back(decoded.path);
+  }
+  for (const std::string &map : packed) {
+    sources.emplace_back(map);
+  }
+  bool readable = std::any_of(sources.begin(), sources.end(),
+                              [](const MappedFile &f) { return f.valid(); });
+  MappedFile &source = sources.front();
+  uint64_t hash{0};
+  uint32_t variant = TextureCache::variant(type, compress, tier, max_size);
+  if (cache && readable) {
+    hash = TextureCache::hash(sources);
+    decoded.cached = cache->find(hash, variant);
+  }
+  if (!decoded.cached.valid() && packed.empty() && source.valid() &&
+      HdrImage::is_hdr(source.bytes())) {
+    HdrImage image = HdrImage::load(source.bytes());
+    generate_mips(image, MipFilter::BOX, &pool);
+    // Same tier as LDR sources, the reduced image is one of the mips
+    int reduction = reduction_levels(image.width, image.height, tier,
+                                     max_size);
+    if (reduction > 0) {
+      int width = image.level_width(reduction);
+      int height = image.level_height(reduction);
+      image.pixels = std::move(image.mips[reduction - 1]);
+      image.mips.erase(image.mips.begin(), image.mips.begin() + reduction);
+      image.width = width;
+      image.height = height;
+    }
+    decoded.channels = HdrImage::channels;
+    if (compress && !image.empty()) {
+      decoded.compressed = ::compress(image, &pool);
+      if (cache) {
+        cache->store(hash, variant, decoded.compressed, HdrImage::channels);
+      }
+    } else {
+      decoded.hdr = pack(image, HdrFormat::RGB9_E5, &pool);
+    }
+  } else if (!decoded.cached.valid() && readable) {
+    bool srgb = type == Texture::TextureType::DIFFUSE;
+    auto decode = [&](const MappedFile &file, bool colour) {
+      int width{}, height{}, reduction{0};
+      if (!file.valid()) {
+        return Image{};
+      }
+      if (image_size(file.bytes(), width, height)) {
+        reduction = reduction_levels(width, height, tier, max_size);
+      }
+      return decode_image(file.bytes(), reduction, colour, &pool);
+    };
+    if (packed.empty()) {
+      decoded.image = decode(source, srgb);
+    } else {
+      // Only the diffuse map of a material is colour
+      std::vector<Image> maps;
+      for (size_t i = 0; i < sources.size(); ++i) {
+        maps.push_back(decode(sources[i], srgb && i == 0));
+      }
+      decoded.image = pack_material(type, maps);
+    }
+    decoded.channels = decoded.image.channels;
+    generate_mips(decoded.image, srgb, MipFilter::BOX, &pool);
+    if (compress && !decoded.image.empty()) {
+      decoded.compressed = ::compress(
+          decoded.image, Texture::block_format(decoded.image.channels, type),
+          &pool);
+      decoded.image.pixels = {};
+    }
+    if (cache && !decoded.compressed.empty()) {
+      cache->store(hash, variant, decoded.compressed, decoded.channels);
+    } else if (cache && !decoded.image.empty() &&
+               cache->store(hash, variant, decoded.image) && decoded.done) {
+      // File loads hand over the entry just written, not the image
+      decoded.cached = cache->find(hash, variant);
+    }
+  }
+}
+
+void TextureLoader::push(Decoded decoded) {
+  // The queue only fills up if the GL thread stops polling
+  while (!finished.try_push(std::move(decoded))) {
+    if (stopping) {
+      return;
+    }
+    std::this_thread::yield();
+  }
+}
+
+MaterialLayout TextureLoader::load_material(Texture &albedo, Texture *scalars,
+                                           const MaterialPaths &paths,
+                                           bool compress) {
+  MaterialLayout layout = material_layout(paths);
+  if (layout.scalar_map && !scalars) {
+    // Nowhere to put roughness and AO, fall back to specular in alpha
+    std::cout << "ERROR::TEXTURE_LOADER::NO_SCALAR_TEXTURE\n" << paths.diffuse
+              << std::endl;
+    layout = material_layout({paths.diffuse, paths.specular, "", ""});
+  }
+  std::vector<std::string> albedo_maps;
+  if (layout.specular_in_alpha) {
+    albedo_maps = {paths.diffuse, paths.specular};
+  }
+  load(albedo, paths.diffuse, compress, std::move(albedo_maps));
+  if (!layout.scalar_map) {
+    return layout;
+  }
+  // Any of the maps, it only names the texture and marks it evictable
+  std::string name = paths.specular;
+  if (name.empty()) {
+    name = paths.roughness.empty() ? paths.ao : paths.roughness;
+  }
+  load(*scalars, name, compress, {paths.specular, paths.roughness, paths.ao});
+  return layout;
+}
+
+size_t TextureLoader::poll(size_t max_uploads) {
+  size_t uploaded{0};
+  while (uploaded < max_uploads) {
+    std::optional<Decoded> decoded = finished.try_pop();
+    if (!decoded) {
+      break;
+    }
+    if (decoded->done) {
+      if (!decoded->cached.valid()) {
+        std::cout << "ERROR::TEXTURE::LOAD_FAILED\n"
+                  << decoded->path << std::endl;
+      }
+      decoded->done(std::move(decoded->cached));
+      --in_flight;
+      ++uploaded;
+      continue;
+    }
+    Texture &texture = *decoded->texture;
+    texture.end_load();
+    if (decoded->cached.valid()) {
+      if (uploader) {
+        uploader->enqueue(texture, std::move(decoded->cached));
+      } else {
+        texture.upload(decoded->cached);
+      }
+      --in_flight;
+      ++uploaded;
+      continue;
+    }
+    if (decoded->image.empty() && decoded->compressed.empty() &&
+        decoded->hdr.empty()) {
+      std::cout << "ERROR::TEXTURE::LOAD_FAILED\n"
+                << decoded->path << std::endl;
+    }
+    if (!decoded->hdr.empty()) {
+      if (uploader) {
+        uploader->enqueue(texture, std::move(decoded->hdr));
+      } else {
+        texture.upload(decoded->hdr);
+      }
+    } else if (!decoded->compressed.empty()) {
+      if (uploader) {
+        uploader->enqueue(texture, std::move(decoded->compressed),
+                          decoded->channels);
+      } else {
+        texture.upload(decoded->compressed, decoded->channels);
+      }
+    } else if (uploader) {
+      uploader->enqueue(texture, std::move(decoded->image));
+    } else {
+      texture.upload(decoded->image,
+                     Texture::pixel_format(decoded->image.channels));
+    }
+    --in_flight;
+    ++uploaded;
+  }
+  return uploaded;
+}
+
+void TextureLoader::finish() {
+  while (!idle()) {
+    if (poll() == 0) {
+      std::this_thread::yield();
+    }
+  }
+  if (uploader) {
+    uploader->flush();
+  }
+}
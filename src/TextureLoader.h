@@ -0,0 +1,113 @@
+#ifndef OPENGLTEMPL_TEXTURELOADER_H
+#define OPENGLTEMPL_TEXTURELOADER_H
+
+#include "Image.h"
+#include "LockFreeQueue.h"
+#include "MaterialPacker.h"
+#include "MipGenerator.h"
+#include "Texture.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+#include "UploadScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Decodes images on a worker pool and hands them back to the GL thread
+// through a lock-free queue. Textures stay PENDING (and bind the placeholder)
+// until poll() uploads them, so nothing on the render path waits on decoding.
+class TextureLoader {
+private:
+  struct Decoded {
+    Texture *texture{};
+    std::string path;
+    Image image;
+    CompressedImage compressed;
+    PackedHdrImage hdr;
+    TextureFile cached;
+    // Of the source, compressed and HDR chains don't carry their own
+    int channels{};
+    // Set for load_file(), which hands over cached instead of uploading
+    std::function<void(TextureFile)> done;
+  };
+
+  UploadScheduler *uploader;
+  TextureCache *cache;
+  std::atomic<TextureQuality> quality{TextureQuality::FULL};
+  std::atomic<int> max_dimension{0};
+  LockFreeQueue<Decoded> finished;
+  std::atomic<size_t> in_flight{0};
+  std::atomic<bool> stopping{false};
+  // Declared last so workers are joined before the queue goes away
+  ThreadPool pool;
+
+  // Worker side of a load, fills decoded from the cache or the sources
+  void decode(Decoded &decoded, Texture::TextureType type,
+              const std::vector<std::string> &packed, bool compress,
+              TextureQuality tier, int max_size);
+  void push(Decoded decoded);
+
+public:
+  // Without an uploader poll() pushes each image synchronously. With a cache,
+  // textures seen before are mapped from disk instead of decoded. Create it on
+  // the GL thread, it checks which block formats the driver takes.
+  explicit TextureLoader(
+      UploadScheduler *upload_scheduler = nullptr,
+      TextureCache *texture_cache = nullptr,
+      size_t workers = std::max(2u, std::thread::hardware_concurrency()) - 1,
+      size_t queue_capacity = 256);
+  ~TextureLoader();
+
+  // The texture must outlive the loader or at least the next poll() that
+  // uploads it. With compress the worker also block compresses the image
+  // (format picked by Texture::block_format) and uploads the whole chain.
+  // HDR sources become BC6H with compress and RGB9_E5 without. With
+  // packed_paths the texture is those maps combined by pack_material()
+  // instead, path only names it. Either way the texture remembers what it was
+  // loaded from for reloads, replacing what an earlier load left there.
+  void load(Texture &texture, std::string path, bool compress = false,
+            std::vector<std::string> packed_paths = {});
+
+  // For consumers that aren't a Texture (virtual texture pages, array
+  // layers): decodes like an uncompressed load() into the cache, then poll()
+  // calls done on the GL thread with the mapped entry. Needs a cache, and
+  // done gets an invalid TextureFile if the sources can't be read or are HDR.
+  void load_file(Texture::TextureType type, std::string path,
+                 std::function<void(TextureFile)> done,
+                 std::vector<std::string> packed_paths = {});
+
+  // Loads a material with its scalar maps packed into spare channels, see
+  // MaterialLayout. scalars is only used when the layout has a scalar map,
+  // without one roughness and AO are left out of the returned layout. Compile
+  // the shader with the returned layout's defines.
+  MaterialLayout load_material(Texture &albedo, Texture *scalars,
+                               const MaterialPaths &paths,
+                               bool compress = false);
+
+  // Resolution tier for loads queued from now on. Images are reduced right
+  // after decoding, so low tiers use less memory and skip most of the mip and
+  // compression work. A max_dimension of 0 means no limit.
+  void set_quality(TextureQuality tier, int max_size = 0) {
+    quality = tier;
+    max_dimension = max_size;
+  }
+
+  // Hands up to max_uploads finished images, cache hits, block compressed and
+  // HDR chains included, to the uploader (or uploads them directly) and
+  // finished file loads to their callbacks. Call once a frame from the GL
+  // thread, returns how many images were handed over.
+  size_t poll(size_t max_uploads = std::numeric_limits<size_t>::max());
+
+  // Blocks the GL thread until every queued texture is uploaded.
+  void finish();
+
+  bool idle() const { return in_flight.load() == 0; }
+};
+
+#endif // OPENGLTEMPL_TEXTURELOADER_H
@@ -0,0 +1,104 @@
+#ifndef OPENGLTEMPL_THREADPOOL_H
+#define OPENGLTEMPL_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling jobs off a shared queue. Jobs must not
+// touch OpenGL, the context only lives on the render thread.
+class ThreadPool {
+private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> jobs;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool stopping{false};
+
+  void work() {
+    while (true) {
+      std::function<void()> job;
+      {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (stopping && jobs.empty()) {
+          return;
+        }
+        job = std::move(jobs.front());
+        jobs.pop();
+      }
+      job();
+    }
+  }
+
+public:
+  explicit ThreadPool(
+      size_t count = std::max(2u, std::thread::hardware_concurrency()) - 1) {
+    workers.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      workers.emplace_back(&ThreadPool::work, this);
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Finishes every queued job before joining.
+  ~ThreadPool() {
+    {
+      std::lock_guard lock{mutex};
+      stopping = true;
+    }
+    cv.notify_all();
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+  }
+
+  void submit(std::function<void()> job) {
+    {
+      std::lock_guard lock{mutex};
+      jobs.push(std::move(job));
+    }
+    cv.notify_one();
+  }
+
+  // Runs fn(0) .. fn(count - 1) across the pool and the calling thread and
+  // returns once all of them finished. The caller claims work too, so this is
+  // safe to call from inside a job.
+  template <typename F> void parallel_for(size_t count, F &&fn) {
+    struct Progress {
+      std::atomic<size_t> next{0};
+      std::atomic<size_t> done{0};
+    };
+    auto progress = std::make_shared<Progress>();
+    // Helpers that start after everything is claimed never touch fn
+    auto run = [progress, count, &fn] {
+      for (size_t i; (i = progress->next++) < count;) {
+        fn(i);
+        if (++progress->done == count) {
+          progress->done.notify_all();
+        }
+      }
+    };
+    size_t helpers = std::min(workers.size(), count ? count - 1 : 0);
+    for (size_t i = 0; i < helpers; ++i) {
+      submit(run);
+    }
+    run();
+    for (size_t done; (done = progress->done.load()) < count;) {
+      progress->done.wait(done);
+    }
+  }
+
+  size_t size() const { return workers.size(); }
+};
+
+#endif // OPENGLTEMPL_THREADPOOL_H
@@ -0,0 +1,256 @@
+#include "UploadScheduler.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr GLbitfield map_flags =
+    GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+UploadScheduler::UploadScheduler(size_t budget_bytes, size_t frames_in_flight)
+    : budget(budget_bytes) {
+  glCreateBuffers(1, &id_);
+  glNamedBufferStorage(id_, budget * frames_in_flight, nullptr, map_flags);
+  mapped = static_cast<unsigned char *>(
+      glMapNamedBufferRange(id_, 0, budget * frames_in_flight, map_flags));
+  for (size_t i = 0; i < frames_in_flight; ++i) {
+    regions.push_back({i * budget});
+  }
+}
+
+UploadScheduler::~UploadScheduler() {
+  for (Region &region : regions) {
+    if (region.fence) {
+      glDeleteSync(region.fence);
+    }
+  }
+  glUnmapNamedBuffer(id_);
+  glDeleteBuffers(1, &id_);
+}
+
+void UploadScheduler::enqueue(Texture &texture, Image image) {
+  if (image.empty()) {
+    texture.state = Texture::TextureState::FAILED;
+    return;
+  }
+  supersede(texture);
+  GLuint target =
+      texture.allocate(image.width, image.height, image.channels,
+                       static_cast<GLsizei>(image.level_count()));
+  Job job{&texture, target};
+  job.format = Texture::pixel_format(image.channels);
+  job.type = GL_UNSIGNED_BYTE;
+  job.unit_bytes = static_cast<size_t>(image.channels);
+  job.source = std::move(image);
+  push(std::move(job));
+}
+
+void UploadScheduler::enqueue(Texture &texture, CompressedImage image,
+                              int channels) {
+  if (image.empty()) {
+    texture.state = Texture::TextureState::FAILED;
+    return;
+  }
+  supersede(texture);
+  GLuint target = texture.allocate(
+      image.width, image.height, channels,
+      static_cast<GLsizei>(image.levels.size()),
+      ::internal_format(image.format));
+  Job job{&texture, target};
+  job.format = ::internal_format(image.format);
+  job.unit_bytes = block_bytes(image.format);
+  job.source = std::move(image);
+  push(std::move(job));
+}
+
+void UploadScheduler::enqueue(Texture &texture, PackedHdrImage image) {
+  if (image.empty()) {
+    texture.state = Texture::TextureState::FAILED;
+    return;
+  }
+  supersede(texture);
+  GLuint target = texture.allocate(
+      image.width, image.height, HdrImage::channels,
+      static_cast<GLsizei>(image.levels.size()),
+      ::internal_format(image.format));
+  Job job{&texture, target};
+  job.format = GL_RGB;
+  job.type = pixel_type(image.format);
+  job.unit_bytes = sizeof(uint32_t);
+  job.source = std::move(image);
+  push(std::move(job));
+}
+
+void UploadScheduler::enqueue(Texture &texture, TextureFile file) {
+  if (!file.valid()) {
+    texture.state = Texture::TextureState::FAILED;
+    return;
+  }
+  supersede(texture);
+  const TextureFileHeader &header = file.header();
+  GLuint target = texture.allocate(
+      static_cast<int>(header.width), static_cast<int>(header.height),
+      static_cast<int>(header.channels),
+      static_cast<GLsizei>(file.level_count()), header.internal_format);
+  Job job{&texture, target};
+  if (file.compressed()) {
+    job.format = header.internal_format;
+    job.unit_bytes = file.block_bytes();
+  } else {
+    job.format = header.pixel_format;
+    job.type = GL_UNSIGNED_BYTE;
+    job.unit_bytes = header.channels;
+  }
+  job.source = std::move(file);
+  push(std::move(job));
+}
+
+void UploadScheduler::supersede(const Texture &texture) {
+  // Strips already sent went to storage allocate() is about to delete, GL
+  // keeps it alive until those commands are done with it
+  std::erase_if(jobs, [&](const Job &job) { return job.texture == &texture; });
+}
+
+void UploadScheduler::push(Job job) {
+  Job &queued = jobs.emplace_back(std::move(job));
+  if (auto *image = std::get_if<Image>(&queued.source)) {
+    for (size_t i = 0; i < image->level_count(); ++i) {
+      queued.levels.push_back({image->level(i).data(), image->level_width(i),
+                               image->level_height(i)});
+    }
+  } else if (auto *blocks = std::get_if<CompressedImage>(&queued.source)) {
+    for (size_t i = 0; i < blocks->levels.size(); ++i) {
+      queued.levels.push_back({blocks->levels[i].data(), blocks->level_width(i),
+                               blocks->level_height(i)});
+    }
+  } else if (auto *hdr = std::get_if<PackedHdrImage>(&queued.source)) {
+    for (size_t i = 0; i < hdr->levels.size(); ++i) {
+      queued.levels.push_back(
+          {reinterpret_cast<const unsigned char *>(hdr->levels[i].data()),
+           hdr->level_width(i), hdr->level_height(i)});
+    }
+  } else if (auto *file = std::get_if<TextureFile>(&queued.source)) {
+    for (size_t i = 0; i < file->level_count(); ++i) {
+      queued.levels.push_back(
+          {file->level(i).data(), file->level_width(i), file->level_height(i)});
+    }
+  }
+}
+
+void UploadScheduler::wait(Region &region) {
+  if (!region.fence) {
+    return;
+  }
+  // Normally signalled long ago, the ring is a few frames deep
+  while (glClientWaitSync(region.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                          1'000'000) == GL_TIMEOUT_EXPIRED) {
+  }
+  glDeleteSync(region.fence);
+  region.fence = nullptr;
+}
+
+size_t UploadScheduler::stage(Job &job, size_t region_offset,
+                              size_t capacity) {
+  const Level &level = job.levels[job.level];
+  auto index = static_cast<GLint>(job.level);
+  int step = job.unit_size();
+  int row_units = job.units(level.width);
+  size_t pitch = row_units * job.unit_bytes;
+  const unsigned char *row = level.data + job.next_row * pitch;
+  int y = job.next_row * step;
+  int row_height = std::min(step, level.height - y);
+
+  auto upload = [&](int x, int width, int height, size_t bytes) {
+    if (job.compressed()) {
+      glCompressedTextureSubImage2D(
+          job.target, index, x, y, width, height, job.format,
+          static_cast<GLsizei>(bytes),
+          reinterpret_cast<const void *>(region_offset));
+    } else {
+      glTextureSubImage2D(job.target, index, x, y, width, height, job.format,
+                          job.type,
+                          reinterpret_cast<const void *>(region_offset));
+    }
+  };
+
+  if (pitch > budget) {
+    // Not even one row fits a frame, send it in pieces
+    int units = std::min(static_cast<int>(capacity / job.unit_bytes),
+                         row_units - job.next_unit);
+    if (units <= 0) {
+      return 0;
+    }
+    size_t bytes = units * job.unit_bytes;
+    std::memcpy(mapped + region_offset, row + job.next_unit * job.unit_bytes,
+                bytes);
+    int x = job.next_unit * step;
+    upload(x, std::min(units * step, level.width - x), row_height, bytes);
+    job.next_unit += units;
+    if (job.next_unit == row_units) {
+      job.next_unit = 0;
+      ++job.next_row;
+    }
+    return bytes;
+  }
+
+  int rows = std::min(static_cast<int>(capacity / pitch),
+                      job.units(level.height) - job.next_row);
+  if (rows <= 0) {
+    return 0;
+  }
+  size_t bytes = rows * pitch;
+  std::memcpy(mapped + region_offset, row, bytes);
+  upload(0, level.width, std::min(rows * step, level.height - y), bytes);
+  job.next_row += rows;
+  return bytes;
+}
+
+void UploadScheduler::frame() {
+  last_frame_bytes_ = 0;
+  if (jobs.empty()) {
+    return;
+  }
+  Region &region = regions[current];
+  wait(region);
+
+  GLint alignment;
+  glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, id_);
+
+  size_t used{0};
+  while (!jobs.empty()) {
+    Job &job = jobs.front();
+    // Keep strips 4 byte aligned inside the buffer
+    used = (used + 3) & ~size_t{3};
+    if (used >= budget) {
+      break;
+    }
+    size_t bytes = stage(job, region.offset + used, budget - used);
+    int rows = job.units(job.levels[job.level].height);
+    if (bytes == 0 && job.next_row < rows) {
+      break; // not even one row left in this frame's budget
+    }
+    used += bytes;
+    if (job.next_row == rows) {
+      job.next_row = 0;
+      if (++job.level == job.levels.size()) {
+        job.texture->finish_upload();
+        jobs.pop_front();
+      }
+    }
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+  region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  current = (current + 1) % regions.size();
+  last_frame_bytes_ = used;
+}
+
+void UploadScheduler::flush() {
+  while (!idle()) {
+    frame();
+  }
+}
@@ -0,0 +1,103 @@
+#ifndef OPENGLTEMPL_UPLOADSCHEDULER_H
+#define OPENGLTEMPL_UPLOADSCHEDULER_H
+
+#include <glad/glad.h>
+
+#include "BlockCompression.h"
+#include "HdrImage.h"
+#include "Image.h"
+#include "Texture.h"
+#include "TextureFile.h"
+
+#include <cstddef>
+#include <deque>
+#include <variant>
+#include <vector>
+
+// Streams texture contents through a ring of persistently mapped pixel unpack
+// buffers. Every frame gets its own region of the ring, guarded by a fence, and
+// at most budget bytes are copied per frame. Images are split into row strips
+// so a large texture is spread over several frames instead of stalling one,
+// rows wider than the budget are split into pieces. Block compressed levels
+// go in rows of 4x4 blocks.
+class UploadScheduler {
+private:
+  struct Region {
+    size_t offset;
+    GLsync fence{};
+  };
+
+  struct Level {
+    const unsigned char *data;
+    int width, height;
+  };
+
+  struct Job {
+    Texture *texture;
+    GLuint target;
+    // Owns the pixels levels points into
+    std::variant<Image, CompressedImage, PackedHdrImage, TextureFile> source{};
+    std::vector<Level> levels{};
+    // Pixel format and type, or the block format with type 0
+    GLenum format{}, type{};
+    // Bytes of a texel, or of a block when compressed
+    size_t unit_bytes{};
+    size_t level{0};
+    // In rows of blocks when compressed, next_unit is the next texel (or
+    // block) of a row split over several strips
+    int next_row{0};
+    int next_unit{0};
+
+    bool compressed() const { return type == 0; }
+    int unit_size() const { return compressed() ? 4 : 1; }
+    int units(int texels) const {
+      return (texels + unit_size() - 1) / unit_size();
+    }
+  };
+
+  GLuint id_{};
+  unsigned char *mapped{};
+  size_t budget;
+  std::vector<Region> regions;
+  size_t current{0};
+  std::deque<Job> jobs;
+  size_t last_frame_bytes_{0};
+
+  void wait(Region &region);
+  // Drops a queued job for the texture, the new one replaces its storage
+  void supersede(const Texture &texture);
+  // Queues the job and points its levels into the source
+  void push(Job job);
+  // Copies rows of the front job into the mapped region, returns bytes used
+  size_t stage(Job &job, size_t region_offset, size_t capacity);
+
+public:
+  // frames_in_flight regions of budget_bytes each are allocated up front
+  explicit UploadScheduler(size_t budget_bytes = 4 << 20,
+                           size_t frames_in_flight = 3);
+  ~UploadScheduler();
+
+  UploadScheduler(const UploadScheduler &) = delete;
+  UploadScheduler &operator=(const UploadScheduler &) = delete;
+
+  // Takes ownership of the pixels, every mip level the image carries is
+  // streamed and the texture becomes READY once the last strip is copied.
+  // A job still queued for the same texture is dropped, the newest wins.
+  void enqueue(Texture &texture, Image image);
+  void enqueue(Texture &texture, CompressedImage image, int channels);
+  void enqueue(Texture &texture, PackedHdrImage image);
+  // Cache entries are copied straight out of their mapping
+  void enqueue(Texture &texture, TextureFile file);
+
+  // Call once a frame on the GL thread.
+  void frame();
+
+  // Pushes everything that is queued, ignoring the budget.
+  void flush();
+
+  bool idle() const { return jobs.empty(); }
+  size_t last_frame_bytes() const { return last_frame_bytes_; }
+  size_t budget_bytes() const { return budget; }
+};
+
+#endif // OPENGLTEMPL_UPLOADSCHEDULER_H
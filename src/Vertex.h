@@ -0,0 +1,77 @@
+#ifndef OPENGLTEMPL_VERTEX_H
+#define OPENGLTEMPL_VERTEX_H
+
+#include "VertexLayout.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Authoring layout, 44 bytes
+struct Vertex {
+  glm::vec3 position;
+  glm::vec3 color;
+  glm::vec2 tex_coords;
+  glm::vec3 normal;
+};
+
+// Also the position stream of a split mesh, see split_vertices()
+struct Vertex2 {
+  glm::vec3 position;
+};
+
+// Everything of a Vertex but its position, 32 bytes. The shading stream of a
+// split mesh.
+struct VertexAttributes {
+  glm::vec3 color;
+  glm::vec2 tex_coords;
+  glm::vec3 normal;
+};
+
+// What quantize() turns a Vertex into, 20 bytes. Positions are unorm16 in the
+// mesh's bounding box, see QuantizedMesh::dequantize().
+struct PackedVertex {
+  uint16_t position[4]; // xyz, w is padding
+  uint32_t normal;      // snorm GL_INT_2_10_10_10_REV
+  uint16_t tex_coords[2]; // half floats
+  uint8_t color[4];       // unorm8, alpha unused
+};
+
+template <> struct VertexLayout<Vertex> {
+  static constexpr Attribute attributes[]{
+      VERTEX_ATTRIBUTE(Vertex, position, 0),
+      VERTEX_ATTRIBUTE(Vertex, color, 1),
+      VERTEX_ATTRIBUTE(Vertex, tex_coords, 2),
+      VERTEX_ATTRIBUTE(Vertex, normal, 3)};
+};
+static_assert(valid_layout<Vertex>());
+
+template <> struct VertexLayout<Vertex2> {
+  static constexpr Attribute attributes[]{
+      VERTEX_ATTRIBUTE(Vertex2, position, 0)};
+};
+static_assert(valid_layout<Vertex2>());
+
+// Same locations as Vertex, position comes from the Vertex2 stream
+template <> struct VertexLayout<VertexAttributes> {
+  static constexpr Attribute attributes[]{
+      VERTEX_ATTRIBUTE(VertexAttributes, color, 1),
+      VERTEX_ATTRIBUTE(VertexAttributes, tex_coords, 2),
+      VERTEX_ATTRIBUTE(VertexAttributes, normal, 3)};
+};
+static_assert(valid_layout<VertexAttributes>());
+
+// Same locations as Vertex, a shader takes either
+template <> struct VertexLayout<PackedVertex> {
+  static constexpr Attribute attributes[]{
+      VERTEX_ATTRIBUTE(PackedVertex, position, 0,
+                       {GL_UNSIGNED_SHORT, 3, GL_TRUE}),
+      VERTEX_ATTRIBUTE(PackedVertex, color, 1, {GL_UNSIGNED_BYTE, 3, GL_TRUE}),
+      VERTEX_ATTRIBUTE(PackedVertex, tex_coords, 2, {GL_HALF_FLOAT, 2}),
+      VERTEX_ATTRIBUTE(PackedVertex, normal, 3,
+                       {GL_INT_2_10_10_10_REV, 4, GL_TRUE})};
+};
+static_assert(valid_layout<PackedVertex>());
+static_assert(sizeof(PackedVertex) == 20);
+
+#endif // OPENGLTEMPL_VERTEX_H
@@ -8,56 +8,68 @@
 #include <cstddef>
 #include <glad/glad.h>
 
+#include "Attribute.h"
 #include "Camera.h"
 #include "IndexBuffer.h"
 #include "Program.h"
 #include "Texture.h"
+#include "Vertex.h"
 #include "VertexBuffer.h"
+#include "VertexLayout.h"
 
 #include <iostream>
 #include <string>
 #include <utility>
-
-struct Attribute {
-    GLuint attrib_index;
-    size_t offset;
-    std::pair<GLenum, GLint> type_size;
-};
+#include <vector>
 
 template<typename T, typename U>
 class VertexArray {
 private:
     GLuint id_{};
     std::span<Texture> textures;
-    IndexBuffer<U> ibo_;
+    // Owned by the caller, like the vertex buffers
+    const IndexBuffer<U> &ibo_;
+    // Sampler locations per program drawn with, one per texture
+    std::vector<std::pair<GLuint, std::vector<GLint>>> sampler_locations;
+    GLsizei instance_stride{0};
+    // Set when the VAO belongs to a VertexArrayCache and every draw binds this mesh's buffers
+    GLuint vertex_buffer{0};
+    GLsizei vertex_stride{0};
+    bool shared{false};
+    // Positions alone, only for split meshes
+    GLuint position_id_{0};
 
-public:
-    VertexArray(VertexBuffer<T> vbo, IndexBuffer<U> ibo, std::span<Attribute> attribs, std::span<Texture> tex)
-            : textures(tex), ibo_(ibo) {
-        glCreateVertexArrays(1, &id_);
-
-        for (int i = 0; i < attribs.size(); ++i) {
-            Attribute attrib{attribs[i]};
-            glEnableVertexArrayAttrib(id_, attrib.attrib_index);
-            glVertexArrayAttribBinding(id_, attrib.attrib_index, 0);
-            glVertexArrayAttribFormat(id_, attrib.attrib_index, attrib.type_size.second, attrib.type_size.first,
-                                      GL_FALSE, attrib.offset);
+    static void set_attributes(GLuint vao, std::span<const Attribute> attribs, GLuint binding) {
+        for (const Attribute &attrib: attribs) {
+            glEnableVertexArrayAttrib(vao, attrib.attrib_index);
+            glVertexArrayAttribBinding(vao, attrib.attrib_index, binding);
+            glVertexArrayAttribFormat(vao, attrib.attrib_index, attrib.type_size.second, attrib.type_size.first,
+                                      attrib.normalized, attrib.offset);
         }
-
-        glVertexArrayVertexBuffer(id_, 0, vbo, 0, vbo.stride);
-        glVertexArrayElementBuffer(id_, ibo_);
     }
 
-    ~VertexArray() { glDeleteVertexArrays(1, &id_); }
+    void bind() {
+        if (shared) {
+            glVertexArrayVertexBuffer(id_, 0, vertex_buffer, 0, vertex_stride);
+            glVertexArrayElementBuffer(id_, ibo_);
+        }
+        glBindVertexArray(id_);
+    }
 
-    void draw(const Program &program, const Camera &camera) {
+    const std::vector<GLint> &locate_samplers(const Program &program) {
+        for (const auto &[located, locations]: sampler_locations) {
+            if (located == program) {
+                return locations;
+            }
+        }
         GLuint diff_i{0};
         GLuint spec_i{0};
+        GLuint norm_i{0};
+        std::vector<GLint> locations;
         // Somehow picking a texture fucks the entire program, I don't konw what causes this. this is so fucking stupid
         // auto tex = &textures[0];
         for (Texture& tex: textures) {
             std::string tex_name;
-            GLuint i = diff_i + spec_i;
             switch (tex.type) {
                 case Texture::TextureType::DIFFUSE:
                     tex_name = "diff_" + std::to_string(diff_i++);
@@ -65,15 +77,133 @@ public:
                 case Texture::TextureType::SPECULAR:
                     tex_name = "spec_" + std::to_string(spec_i++);
                     break;
+                case Texture::TextureType::NORMAL:
+                    tex_name = "norm_" + std::to_string(norm_i++);
+                    break;
             }
-            tex.bind(i);
-            glUniform1i(glGetUniformLocation(program, tex_name.c_str()), i);
+            locations.push_back(glGetUniformLocation(program, tex_name.c_str()));
+        }
+        return sampler_locations.emplace_back(program, std::move(locations)).second;
+    }
 
+    // Texture i goes to unit i. Materials that differ per draw belong in a TextureArray indexed by
+    // DrawData::material instead, so they don't split instanced draws.
+    void bind_textures(const Program &program) {
+        const std::vector<GLint> &locations = locate_samplers(program);
+        for (GLuint i = 0; i < textures.size(); ++i) {
+            textures[i].bind(i);
+            glUniform1i(locations[i], static_cast<GLint>(i));
         }
+    }
+
+public:
+    static constexpr GLuint instance_binding = 1;
+    static constexpr GLuint attribute_binding = 2;
+
+    // Buffers by reference, a by value copy would delete the GL names when it goes out of scope
+    VertexArray(const VertexBuffer<T> &vbo, const IndexBuffer<U> &ibo, std::span<const Attribute> attribs,
+                std::span<Texture> tex)
+            : textures(tex), ibo_(ibo) {
+        glCreateVertexArrays(1, &id_);
+        set_attributes(id_, attribs, 0);
+        glVertexArrayVertexBuffer(id_, 0, vbo, 0, vbo.stride);
+        glVertexArrayElementBuffer(id_, ibo_);
+    }
 
+    // Attribute formats from VertexLayout<T>
+    VertexArray(const VertexBuffer<T> &vbo, const IndexBuffer<U> &ibo, std::span<Texture> tex)
+            : VertexArray(vbo, ibo, VertexLayout<T>::attributes, tex) {}
+
+    // Shares the VAO of T's layout with every other mesh of that layout. Instance streams would be shared too, keep
+    // instanced meshes on their own VAO.
+    VertexArray(VertexArrayCache &cache, const VertexBuffer<T> &vbo, const IndexBuffer<U> &ibo, std::span<Texture> tex)
+            : id_(cache.get<T>()), textures(tex), ibo_(ibo), vertex_buffer(vbo),
+              vertex_stride(static_cast<GLsizei>(vbo.stride)), shared(true) {}
+
+    // Split mesh, see split_vertices(). Positions sit tightly packed on binding 0 and T, the rest of the vertex, on
+    // attribute_binding. A second VAO with only the positions serves draw_positions(), so depth, shadow and picking
+    // passes fetch 12 bytes a vertex instead of the whole vertex.
+    VertexArray(const VertexBuffer<Vertex2> &positions, const VertexBuffer<T> &attributes, const IndexBuffer<U> &ibo,
+                std::span<Texture> tex)
+            : textures(tex), ibo_(ibo) {
+        GLuint vaos[2];
+        glCreateVertexArrays(2, vaos);
+        id_ = vaos[0];
+        position_id_ = vaos[1];
+        for (GLuint vao: vaos) {
+            set_attributes(vao, VertexLayout<Vertex2>::attributes, 0);
+            glVertexArrayVertexBuffer(vao, 0, positions, 0, positions.stride);
+            glVertexArrayElementBuffer(vao, ibo_);
+        }
+        set_attributes(id_, VertexLayout<T>::attributes, attribute_binding);
+        glVertexArrayVertexBuffer(id_, attribute_binding, attributes, 0, attributes.stride);
+    }
+
+    VertexArray(const VertexArray &) = delete;
+    VertexArray &operator=(const VertexArray &) = delete;
+
+    ~VertexArray() {
+        if (!shared) {
+            glDeleteVertexArrays(1, &id_);
+        }
+        if (position_id_) {
+            glDeleteVertexArrays(1, &position_id_);
+        }
+    }
+
+    // Per-instance attributes on their own binding, advancing once every divisor instances. The data comes from
+    // set_instance_buffer(), typically a StreamBuffer slice written this frame.
+    void set_instance_attributes(std::span<const Attribute> attribs, GLsizei stride, GLuint divisor = 1) {
+        set_attributes(id_, attribs, instance_binding);
+        glVertexArrayBindingDivisor(id_, instance_binding, divisor);
+        instance_stride = stride;
+    }
+    void set_instance_buffer(GLuint buffer, GLintptr offset = 0) {
+        glVertexArrayVertexBuffer(id_, instance_binding, buffer, offset, instance_stride);
+    }
+
+    // For shaders that read the camera from a uniform block
+    void draw(const Program &program) {
+        bind_textures(program);
+        bind();
+        glDrawElements(ibo_.get_draw_mode(), ibo_.get_size(), ibo_.get_index_type(), nullptr);
+    }
+
+    // Geometry only pass, no textures bound. Split meshes fetch nothing but positions, the rest draw as usual.
+    // Instanced like draw_instanced() so the pass can read per-draw data too.
+    void draw_positions(GLsizei count = 1, GLuint base_instance = 0) {
+        if (position_id_) {
+            glBindVertexArray(position_id_);
+        } else {
+            bind();
+        }
+        glDrawElementsInstancedBaseInstance(ibo_.get_draw_mode(), ibo_.get_size(), ibo_.get_index_type(), nullptr,
+                                            count, base_instance);
+    }
+
+    // count copies in one draw. Instances read their attributes from the instance stream, or index an SSBO the
+    // caller bound with gl_InstanceID + gl_BaseInstance
+    void draw_instanced(const Program &program, GLsizei count, GLuint base_instance = 0) {
+        bind_textures(program);
+        bind();
+        glDrawElementsInstancedBaseInstance(ibo_.get_draw_mode(), ibo_.get_size(), ibo_.get_index_type(), nullptr,
+                                            count, base_instance);
+    }
+
+    // Draws count indices from another buffer, like the triangles cull_meshlets() kept this frame written to a
+    // StreamBuffer. offset is in bytes.
+    void draw(const Program &program, GLuint index_buffer, GLintptr offset, GLsizei count,
+              GLenum type = GL_UNSIGNED_INT) {
+        bind_textures(program);
+        bind();
+        glVertexArrayElementBuffer(id_, index_buffer);
+        glDrawElements(ibo_.get_draw_mode(), count, type, reinterpret_cast<const void *>(offset));
+        glVertexArrayElementBuffer(id_, ibo_);
+    }
+
+    void draw(const Program &program, const Camera &camera) {
         camera.uniform(program, "camera");
-        glBindVertexArray(id_);
-        glDrawElements(ibo_.get_draw_mode(), ibo_.get_size(), GL_UNSIGNED_INT, nullptr);
+        draw(program);
     }
 
     operator GLuint() const { return id_; }
@@ -17,8 +17,15 @@ private:
 public:
   size_t stride;
   explicit VertexBuffer(const std::span<T> &data, size_t stride);
+  // Tightly packed
+  explicit VertexBuffer(const std::span<T> &data)
+      : VertexBuffer(data, sizeof(T)) {}
   virtual ~VertexBuffer();
 
+  // A copy would delete the buffer out from under the original
+  VertexBuffer(const VertexBuffer &) = delete;
+  VertexBuffer &operator=(const VertexBuffer &) = delete;
+
   operator GLuint() const { return id_; }
 };
 
@@ -0,0 +1,137 @@
+#ifndef OPENGLTEMPL_VERTEXLAYOUT_H
+#define OPENGLTEMPL_VERTEXLAYOUT_H
+
+#include <glad/glad.h>
+
+#include "Attribute.h"
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <span>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+
+// How one attribute is stored, GL's side of glVertexArrayAttribFormat
+struct AttributeFormat {
+  GLenum type;
+  GLint size;
+  GLboolean normalized{GL_FALSE};
+};
+
+constexpr size_t attribute_bytes(const AttributeFormat &format) {
+  switch (format.type) {
+  case GL_INT_2_10_10_10_REV:
+  case GL_UNSIGNED_INT_2_10_10_10_REV:
+  case GL_UNSIGNED_INT_10F_11F_11F_REV:
+    return 4;
+  case GL_BYTE:
+  case GL_UNSIGNED_BYTE:
+    return format.size;
+  case GL_SHORT:
+  case GL_UNSIGNED_SHORT:
+  case GL_HALF_FLOAT:
+    return 2 * format.size;
+  case GL_DOUBLE:
+    return 8 * format.size;
+  default:
+    return 4 * format.size;
+  }
+}
+
+template <typename> inline constexpr bool no_default_format = false;
+
+// Float members need no format spelled out, anything packed does
+template <typename M> constexpr AttributeFormat default_format() {
+  if constexpr (std::is_same_v<M, float>) {
+    return {GL_FLOAT, 1};
+  } else if constexpr (std::is_same_v<M, glm::vec2>) {
+    return {GL_FLOAT, 2};
+  } else if constexpr (std::is_same_v<M, glm::vec3>) {
+    return {GL_FLOAT, 3};
+  } else if constexpr (std::is_same_v<M, glm::vec4>) {
+    return {GL_FLOAT, 4};
+  } else {
+    static_assert(no_default_format<M>,
+                  "give packed members an AttributeFormat");
+    return {};
+  }
+}
+
+// Throwing makes a bad attribute a compile error in the constexpr layouts
+template <typename M>
+constexpr Attribute layout_attribute(GLuint location, size_t offset,
+                                     AttributeFormat format = default_format<M>()) {
+  if (attribute_bytes(format) > sizeof(M)) {
+    throw "attribute format reads past its member";
+  }
+  return {location, offset, {format.type, format.size}, format.normalized};
+}
+
+// VERTEX_ATTRIBUTE(Vertex, normal, 3) or, for packed members,
+// VERTEX_ATTRIBUTE(PackedVertex, normal, 3, {GL_INT_2_10_10_10_REV, 4, GL_TRUE})
+#define VERTEX_ATTRIBUTE(vertex, member, location, ...)                        \
+  layout_attribute<decltype(vertex::member)>(                                  \
+      location, offsetof(vertex, member) __VA_OPT__(, AttributeFormat __VA_ARGS__))
+
+// Specialise with a constexpr `attributes` array for every vertex struct,
+// the stride is always sizeof(V)
+template <typename V> struct VertexLayout;
+
+// Every attribute inside the vertex, 4 byte aligned, no two overlapping or
+// sharing a location
+template <typename V> constexpr bool valid_layout() {
+  const auto &attributes = VertexLayout<V>::attributes;
+  auto end = [](const Attribute &a) {
+    return a.offset + attribute_bytes({a.type_size.first, a.type_size.second});
+  };
+  for (const Attribute &a : attributes) {
+    if (end(a) > sizeof(V) || a.offset % 4 != 0) {
+      return false;
+    }
+    for (const Attribute &b : attributes) {
+      if (&a != &b && (a.attrib_index == b.attrib_index ||
+                       (a.offset < end(b) && b.offset < end(a)))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// One VAO per vertex layout. Meshes of the same layout share it and only
+// swap their vertex and index buffers, the attribute formats are set once.
+// VertexArray's cache constructor does the swapping, with the buffer's stride.
+class VertexArrayCache {
+private:
+  std::unordered_map<std::type_index, GLuint> vaos;
+
+public:
+  VertexArrayCache() = default;
+  ~VertexArrayCache() {
+    for (auto &[layout, vao] : vaos) {
+      glDeleteVertexArrays(1, &vao);
+    }
+  }
+
+  VertexArrayCache(const VertexArrayCache &) = delete;
+  VertexArrayCache &operator=(const VertexArrayCache &) = delete;
+
+  template <typename V> GLuint get() {
+    auto [it, created] = vaos.try_emplace(std::type_index(typeid(V)), 0);
+    if (created) {
+      glCreateVertexArrays(1, &it->second);
+      for (const Attribute &attrib : VertexLayout<V>::attributes) {
+        glEnableVertexArrayAttrib(it->second, attrib.attrib_index);
+        glVertexArrayAttribBinding(it->second, attrib.attrib_index, 0);
+        glVertexArrayAttribFormat(it->second, attrib.attrib_index,
+                                  attrib.type_size.second,
+                                  attrib.type_size.first, attrib.normalized,
+                                  static_cast<GLuint>(attrib.offset));
+      }
+    }
+    return it->second;
+  }
+};
+
+#endif // OPENGLTEMPL_VERTEXLAYOUT_H
@@ -0,0 +1,123 @@
+#include "VertexPacking.h"
+
+#include "HdrImage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+uint16_t pack_half(float value) {
+  uint16_t half = float_to_half(std::fabs(value));
+  return std::signbit(value) && half ? half | 0x8000 : half;
+}
+
+float unpack_half(uint16_t half) {
+  int exponent = (half >> 10) & 0x1F;
+  int mantissa = half & 0x3FF;
+  float magnitude = exponent == 0
+                        ? std::ldexp(static_cast<float>(mantissa), -24)
+                        : std::ldexp(static_cast<float>(mantissa | 0x400),
+                                     exponent - 25);
+  return half & 0x8000 ? -magnitude : magnitude;
+}
+
+uint32_t pack_snorm_2_10_10_10(const glm::vec3 &v, float w) {
+  auto field = [](float value, float max, int bits) {
+    auto q = static_cast<int32_t>(
+        std::lround(std::clamp(value, -1.0f, 1.0f) * max));
+    return static_cast<uint32_t>(q) & ((1u << bits) - 1);
+  };
+  return field(v.x, 511, 10) | field(v.y, 511, 10) << 10 |
+         field(v.z, 511, 10) << 20 | field(w, 1, 2) << 30;
+}
+
+glm::vec3 unpack_snorm_2_10_10_10(uint32_t packed) {
+  auto field = [&](int shift) {
+    // Sign extend the 10 bits, -512 clamps to -1 like GL does
+    int32_t q = static_cast<int32_t>(packed << (22 - shift)) >> 22;
+    return std::max(static_cast<float>(q) / 511.0f, -1.0f);
+  };
+  return {field(0), field(10), field(20)};
+}
+
+glm::mat4 QuantizedMesh::dequantize() const {
+  glm::mat4 matrix{1.0f};
+  matrix[0][0] = scale.x;
+  matrix[1][1] = scale.y;
+  matrix[2][2] = scale.z;
+  matrix[3] = glm::vec4(offset, 1.0f);
+  return matrix;
+}
+
+QuantizedMesh quantize(std::span<const Vertex> vertices) {
+  QuantizedMesh mesh;
+  if (vertices.empty()) {
+    return mesh;
+  }
+  glm::vec3 lo = vertices[0].position, hi = vertices[0].position;
+  for (const Vertex &vertex : vertices) {
+    lo = glm::min(lo, vertex.position);
+    hi = glm::max(hi, vertex.position);
+  }
+  mesh.offset = lo;
+  for (int i = 0; i < 3; ++i) {
+    // A flat axis keeps a unit scale, every position on it is 0
+    float extent = hi[i] - lo[i];
+    mesh.scale[i] = extent > 0 ? extent : 1.0f;
+  }
+
+  // Errors are measured through what the GPU does: normalize, then the matrix
+  const glm::mat4 decode = mesh.dequantize();
+  QuantizationError &error = mesh.error;
+  mesh.vertices.reserve(vertices.size());
+  for (const Vertex &vertex : vertices) {
+    PackedVertex packed{};
+    for (int i = 0; i < 3; ++i) {
+      float q = std::round((vertex.position[i] - lo[i]) / mesh.scale[i] *
+                           65535.0f);
+      packed.position[i] = static_cast<uint16_t>(std::clamp(q, 0.0f, 65535.0f));
+
+      float c = std::clamp(vertex.color[i], 0.0f, 1.0f);
+      packed.color[i] = static_cast<uint8_t>(std::lround(c * 255.0f));
+      error.color = std::max(error.color,
+                             std::fabs(packed.color[i] / 255.0f - vertex.color[i]));
+    }
+    packed.color[3] = 255;
+
+    glm::vec4 normalized{packed.position[0] / 65535.0f,
+                         packed.position[1] / 65535.0f,
+                         packed.position[2] / 65535.0f, 1.0f};
+    glm::vec4 position = decode * normalized;
+    for (int i = 0; i < 3; ++i) {
+      error.position = std::max(error.position,
+                                std::fabs(position[i] - vertex.position[i]));
+    }
+
+    packed.normal = pack_snorm_2_10_10_10(vertex.normal);
+    glm::vec3 normal = unpack_snorm_2_10_10_10(packed.normal);
+    for (int i = 0; i < 3; ++i) {
+      error.normal = std::max(error.normal, std::fabs(normal[i] - vertex.normal[i]));
+    }
+
+    for (int i = 0; i < 2; ++i) {
+      packed.tex_coords[i] = pack_half(vertex.tex_coords[i]);
+      error.tex_coords =
+          std::max(error.tex_coords, std::fabs(unpack_half(packed.tex_coords[i]) -
+                                               vertex.tex_coords[i]));
+    }
+    mesh.vertices.push_back(packed);
+  }
+  return mesh;
+}
+
+SplitMesh split_vertices(std::span<const Vertex> vertices) {
+  SplitMesh mesh;
+  mesh.positions.reserve(vertices.size());
+  mesh.attributes.reserve(vertices.size());
+  for (const Vertex &vertex : vertices) {
+    mesh.positions.push_back({vertex.position});
+    mesh.attributes.push_back(
+        {vertex.color, vertex.tex_coords, vertex.normal});
+  }
+  return mesh;
+}
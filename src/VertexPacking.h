@@ -0,0 +1,50 @@
+#ifndef OPENGLTEMPL_VERTEXPACKING_H
+#define OPENGLTEMPL_VERTEXPACKING_H
+
+#include <glad/glad.h>
+
+#include "Vertex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+// Signed half float, round to nearest
+uint16_t pack_half(float value);
+float unpack_half(uint16_t half);
+// Components clamped to [-1, 1], w to [-1, 1] in 2 bits
+uint32_t pack_snorm_2_10_10_10(const glm::vec3 &v, float w = 0.0f);
+glm::vec3 unpack_snorm_2_10_10_10(uint32_t packed);
+
+// Largest absolute error per attribute, in the attribute's own units
+struct QuantizationError {
+  float position{}, normal{}, tex_coords{}, color{};
+};
+
+struct QuantizedMesh {
+  std::vector<PackedVertex> vertices;
+  // position = offset + scale * (unorm16 position / 65535), the attribute is
+  // normalized so the shader sees the part in brackets. scale is the extent.
+  glm::vec3 offset{0.0f}, scale{1.0f};
+  QuantizationError error;
+
+  // Fold into the model matrix (model * dequantize()), the vertex shader then
+  // treats the normalized position like any other.
+  glm::mat4 dequantize() const;
+};
+
+// A Vertex mesh as two streams, positions tightly packed for depth, shadow
+// and picking passes and the rest for shading. Same order, so indices stay.
+struct SplitMesh {
+  std::vector<Vertex2> positions;
+  std::vector<VertexAttributes> attributes;
+};
+
+SplitMesh split_vertices(std::span<const Vertex> vertices);
+
+// Import time, packs every vertex and measures what that cost
+QuantizedMesh quantize(std::span<const Vertex> vertices);
+
+#endif // OPENGLTEMPL_VERTEXPACKING_H
@@ -0,0 +1,126 @@
+#include "VertexPuller.h"
+
+const std::string VertexPuller::glsl = R"(
+    struct PulledDraw {
+        mat4 model;
+        uint material;
+        uint vertex_offset;
+        uint format;
+    };
+    layout (std430, binding = 4) readonly buffer PulledVertices {
+        uint vertex_words[];
+    };
+    layout (std430, binding = 5) readonly buffer PulledDraws {
+        PulledDraw pulled_draws[];
+    };
+
+    struct PulledVertex {
+        vec3 position;
+        vec3 color;
+        vec2 tex_coords;
+        vec3 normal;
+    };
+
+    PulledDraw pulled_draw() {
+        return pulled_draws[gl_BaseInstance];
+    }
+
+    vec3 pulled_vec3(uint at) {
+        return uintBitsToFloat(uvec3(vertex_words[at], vertex_words[at + 1u], vertex_words[at + 2u]));
+    }
+
+    vec3 pulled_snorm_10_10_10(uint bits) {
+        ivec3 q = ivec3(bits << 22, bits << 12, bits << 2) >> 22;
+        return max(vec3(q) / 511.0, -1.0);
+    }
+
+    PulledVertex pulled_vertex() {
+        PulledDraw draw = pulled_draw();
+        PulledVertex v = PulledVertex(vec3(0.0), vec3(0.0), vec2(0.0), vec3(0.0, 1.0, 0.0));
+        uint id = uint(gl_VertexID);
+        if (draw.format == 0u) {
+            // Vertex
+            uint at = draw.vertex_offset + id * 11u;
+            v.position = pulled_vec3(at);
+            v.color = pulled_vec3(at + 3u);
+            v.tex_coords = uintBitsToFloat(uvec2(vertex_words[at + 6u], vertex_words[at + 7u]));
+            v.normal = pulled_vec3(at + 8u);
+        } else if (draw.format == 1u) {
+            // PackedVertex, positions stay normalized for the model matrix
+            uint at = draw.vertex_offset + id * 5u;
+            v.position = vec3(unpackUnorm2x16(vertex_words[at]), unpackUnorm2x16(vertex_words[at + 1u]).x);
+            v.normal = pulled_snorm_10_10_10(vertex_words[at + 2u]);
+            v.tex_coords = unpackHalf2x16(vertex_words[at + 3u]);
+            v.color = unpackUnorm4x8(vertex_words[at + 4u]).rgb;
+        } else {
+            // Vertex2
+            v.position = pulled_vec3(draw.vertex_offset + id * 3u);
+        }
+        return v;
+    }
+)";
+
+VertexPuller::VertexPuller(StreamBuffer &stream_buffer, uint32_t vertex_bytes,
+                           uint32_t index_bytes)
+    : vertices_(vertex_bytes), indices_(index_bytes), stream(stream_buffer) {
+  // No attributes at all, only the shared index buffer
+  glCreateVertexArrays(1, &vao_);
+  glVertexArrayElementBuffer(vao_, indices_);
+}
+
+VertexPuller::~VertexPuller() { glDeleteVertexArrays(1, &vao_); }
+
+PulledMesh VertexPuller::add(std::span<const std::byte> vertices,
+                             GLuint format, std::span<const GLuint> indices) {
+  PulledMesh mesh;
+  mesh.vertices = vertices_.upload(vertices, sizeof(GLuint));
+  mesh.indices = indices_.upload(std::as_bytes(indices), sizeof(GLuint));
+  if (!mesh.valid()) {
+    remove(mesh);
+    return {};
+  }
+  mesh.format = format;
+  mesh.first_index = mesh.indices.offset / sizeof(GLuint);
+  mesh.count = static_cast<GLsizei>(indices.size());
+  return mesh;
+}
+
+void VertexPuller::remove(const PulledMesh &mesh) {
+  vertices_.free(mesh.vertices);
+  indices_.free(mesh.indices);
+}
+
+void VertexPuller::add_draw(const PulledMesh &mesh, const glm::mat4 &model,
+                            GLuint material) {
+  if (!mesh.valid()) {
+    return;
+  }
+  commands.push_back({static_cast<GLuint>(mesh.count), 1, mesh.first_index, 0,
+                      static_cast<GLuint>(draws.size())});
+  draws.push_back({model, material,
+                   static_cast<GLuint>(mesh.vertices.offset / sizeof(GLuint)),
+                   mesh.format, 0});
+}
+
+void VertexPuller::submit(GLenum mode) {
+  if (commands.empty()) {
+    return;
+  }
+  StreamBuffer::Slice draw_slice =
+      stream.storage(std::span<const PulledDraw>{draws});
+  StreamBuffer::Slice command_slice = stream.write(
+      std::span<const DrawElementsIndirectCommand>{commands}, sizeof(GLuint));
+  if (draw_slice.valid() && command_slice.valid()) {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, vertices_binding, vertices_);
+    stream.bind_storage(draws_binding, draw_slice);
+    glBindVertexArray(vao_);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream);
+    glMultiDrawElementsIndirect(
+        mode, GL_UNSIGNED_INT,
+        reinterpret_cast<const void *>(command_slice.offset),
+        static_cast<GLsizei>(commands.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  }
+  commands.clear();
+  draws.clear();
+}
@@ -0,0 +1,102 @@
+#ifndef OPENGLTEMPL_VERTEXPULLER_H
+#define OPENGLTEMPL_VERTEXPULLER_H
+
+#include <glad/glad.h>
+
+#include "BatchRenderer.h"
+#include "BufferArena.h"
+#include "StreamBuffer.h"
+#include "Vertex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <string>
+#include <vector>
+
+// How the vertex shader decodes a vertex struct, id matches the switch in
+// VertexPuller::glsl and words is the stride in 32 bit words
+template <typename V> struct PulledFormat;
+template <> struct PulledFormat<Vertex> {
+  static constexpr GLuint id = 0, words = 11;
+};
+template <> struct PulledFormat<PackedVertex> {
+  static constexpr GLuint id = 1, words = 5;
+};
+template <> struct PulledFormat<Vertex2> {
+  static constexpr GLuint id = 2, words = 3;
+};
+
+// A mesh stored in a VertexPuller
+struct PulledMesh {
+  BufferArena::Range vertices, indices;
+  GLuint format{};
+  GLuint first_index{};
+  GLsizei count{};
+
+  bool valid() const { return vertices.valid() && indices.valid(); }
+};
+
+// std430 mirror of the shader's PulledDraw
+struct PulledDraw {
+  glm::mat4 model;
+  GLuint material;
+  GLuint vertex_offset; // in words
+  GLuint format;
+  GLuint padding;
+};
+
+// Vertex pulling. Vertices of any layout sit as raw words in one storage
+// buffer and the vertex shader fetches and decodes them itself by
+// gl_VertexID, so meshes of different layouts mix in one multi-draw behind a
+// VAO without attributes. Indices still go through the VAO's element buffer,
+// which keeps the post-transform cache working.
+class VertexPuller {
+private:
+  BufferArena vertices_;
+  BufferArena indices_;
+  GLuint vao_{};
+  StreamBuffer &stream;
+  std::vector<DrawElementsIndirectCommand> commands;
+  std::vector<PulledDraw> draws;
+
+  PulledMesh add(std::span<const std::byte> vertices, GLuint format,
+                 std::span<const GLuint> indices);
+
+public:
+  // Storage buffer bindings the shader reads
+  static constexpr GLuint vertices_binding = 4;
+  static constexpr GLuint draws_binding = 5;
+
+  explicit VertexPuller(StreamBuffer &stream_buffer,
+                        uint32_t vertex_bytes = 64u << 20,
+                        uint32_t index_bytes = 32u << 20);
+  ~VertexPuller();
+
+  VertexPuller(const VertexPuller &) = delete;
+  VertexPuller &operator=(const VertexPuller &) = delete;
+
+  // Invalid mesh (and nothing kept) when either arena is full
+  template <typename V>
+  PulledMesh add(std::span<const V> vertices, std::span<const GLuint> indices) {
+    static_assert(sizeof(V) == 4 * PulledFormat<V>::words);
+    return add(std::as_bytes(vertices), PulledFormat<V>::id, indices);
+  }
+  void remove(const PulledMesh &mesh);
+
+  // Queues a draw, model should include QuantizedMesh::dequantize() for
+  // PackedVertex meshes
+  void add_draw(const PulledMesh &mesh, const glm::mat4 &model,
+                GLuint material = 0);
+  // One glMultiDrawElementsIndirect for every queued draw, whatever their
+  // layouts. The program has to be in use and between the stream's begin
+  // and end_frame().
+  void submit(GLenum mode = GL_TRIANGLES);
+
+  // Paste after #version in the vertex shader, pulled_vertex() fetches this
+  // invocation's vertex and pulled_draw() its draw.
+  static const std::string glsl;
+};
+
+#endif // OPENGLTEMPL_VERTEXPULLER_H
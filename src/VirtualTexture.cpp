@@ -0,0 +1,403 @@
+#include "VirtualTexture.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+const std::string VirtualTexture::glsl = R"(
+    uniform usampler2D vt_page_table;
+    uniform sampler2D vt_cache;
+    uniform float vt_size;
+    uniform float vt_page_size;
+    uniform float vt_border;
+    uniform float vt_slot_size;
+    uniform float vt_cache_size;
+    uniform int vt_max_mip;
+    uniform float vt_feedback_bias;
+
+    float vt_mip(vec2 uv) {
+        vec2 dx = dFdx(uv * vt_size);
+        vec2 dy = dFdy(uv * vt_size);
+        return max(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0.0);
+    }
+
+    vec4 vt_sample(vec2 uv) {
+        int mip = clamp(int(vt_mip(uv)), 0, vt_max_mip);
+        uv = fract(uv);
+        ivec2 page = ivec2(uv * (vt_size / vt_page_size)) >> mip;
+        uvec4 entry = texelFetch(vt_page_table, page, mip);
+        if (entry.a == 0u) {
+            return vec4(1.0);
+        }
+        vec2 in_page = fract(uv * vt_size / (vt_page_size * exp2(float(entry.b))));
+        vec2 texel = vec2(entry.rg) * vt_slot_size + vt_border + in_page * vt_page_size;
+        return textureLod(vt_cache, texel / vt_cache_size, 0.0);
+    }
+
+    uint vt_feedback(vec2 uv) {
+        int mip = clamp(int(vt_mip(uv) - vt_feedback_bias), 0, vt_max_mip);
+        uvec2 page = uvec2(fract(uv) * (vt_size / vt_page_size)) >> mip;
+        return uint(mip) << 24 | page.y << 12 | page.x;
+    }
+)";
+
+const std::string VirtualTexture::feedback_fragment =
+    "#version 460 core\n" + VirtualTexture::glsl + R"(
+    in vec2 tex_coord;
+    out uint feedback;
+
+    void main() {
+        feedback = vt_feedback(tex_coord);
+    }
+)";
+
+namespace {
+constexpr uint32_t no_page = 0xFFFFFFFF;
+
+void copy_region(const unsigned char *level, int width, int height,
+                 int channels, int x, int y, int extent, unsigned char *rgba) {
+  for (int row = 0; row < extent; ++row) {
+    int sy = std::clamp(y + row, 0, height - 1);
+    for (int col = 0; col < extent; ++col) {
+      int sx = std::clamp(x + col, 0, width - 1);
+      const unsigned char *p =
+          level + (static_cast<size_t>(sy) * width + sx) * channels;
+      unsigned char *out = rgba + (static_cast<size_t>(row) * extent + col) * 4;
+      switch (channels) {
+      case 1:
+        out[0] = out[1] = out[2] = p[0];
+        out[3] = 255;
+        break;
+      case 2:
+        out[0] = p[0];
+        out[1] = p[1];
+        out[2] = 0;
+        out[3] = 255;
+        break;
+      default:
+        out[0] = p[0];
+        out[1] = p[1];
+        out[2] = p[2];
+        out[3] = channels == 4 ? p[3] : 255;
+        break;
+      }
+    }
+  }
+}
+} // namespace
+
+void ImagePageSource::read(int mip, int x, int y, int extent,
+                           unsigned char *rgba) const {
+  size_t level = std::min<size_t>(mip, image.level_count() - 1);
+  copy_region(image.level(level).data(), image.level_width(level),
+              image.level_height(level), image.channels, x, y, extent, rgba);
+}
+
+void TextureFilePageSource::read(int mip, int x, int y, int extent,
+                                 unsigned char *rgba) const {
+  size_t level = std::min<size_t>(mip, file.level_count() - 1);
+  copy_region(file.level(level).data(), file.level_width(level),
+              file.level_height(level),
+              static_cast<int>(file.header().channels), x, y, extent, rgba);
+}
+
+VirtualTexture::VirtualTexture(const PageSource &page_source, int screen_width,
+                               int screen_height, int feedback_divisor,
+                               int cache_slots, int page, int page_border,
+                               size_t workers)
+    : source(page_source), page_size(page), border(page_border),
+      slot_size(page + 2 * page_border), slots_per_side(cache_slots),
+      pages(std::max(1, page_source.size() / page)),
+      max_mip(std::countr_zero(static_cast<unsigned>(pages))),
+      feedback_width(std::max(1, screen_width / feedback_divisor)),
+      feedback_height(std::max(1, screen_height / feedback_divisor)),
+      feedback_bias(std::log2(static_cast<float>(feedback_divisor))),
+      slots(static_cast<size_t>(cache_slots) * cache_slots), finished(256),
+      pool(workers) {
+  if (!std::has_single_bit(static_cast<unsigned>(source.size())) ||
+      source.size() < page_size || pages > 4096) {
+    std::cout << "ERROR::VIRTUAL_TEXTURE::UNSUPPORTED_SIZE\n"
+              << source.size() << std::endl;
+  }
+
+  int cache_size = slot_size * slots_per_side;
+  glCreateTextures(GL_TEXTURE_2D, 1, &cache_);
+  glTextureStorage2D(cache_, 1, GL_RGBA8, cache_size, cache_size);
+  glTextureParameteri(cache_, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTextureParameteri(cache_, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTextureParameteri(cache_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTextureParameteri(cache_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  glCreateTextures(GL_TEXTURE_2D, 1, &page_table_);
+  glTextureStorage2D(page_table_, max_mip + 1, GL_RGBA8UI, pages, pages);
+  glTextureParameteri(page_table_, GL_TEXTURE_MIN_FILTER,
+                      GL_NEAREST_MIPMAP_NEAREST);
+  glTextureParameteri(page_table_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  for (int mip = 0; mip <= max_mip; ++mip) {
+    int side = pages >> mip;
+    table.emplace_back(static_cast<size_t>(side) * side, 0);
+  }
+
+  glCreateTextures(GL_TEXTURE_2D, 1, &feedback_);
+  glTextureStorage2D(feedback_, 1, GL_R32UI, feedback_width, feedback_height);
+  glCreateRenderbuffers(1, &depth_);
+  glNamedRenderbufferStorage(depth_, GL_DEPTH_COMPONENT24, feedback_width,
+                             feedback_height);
+  glCreateFramebuffers(1, &fbo_);
+  glNamedFramebufferTexture(fbo_, GL_COLOR_ATTACHMENT0, feedback_, 0);
+  glNamedFramebufferRenderbuffer(fbo_, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                                 depth_);
+  if (glCheckNamedFramebufferStatus(fbo_, GL_FRAMEBUFFER) !=
+      GL_FRAMEBUFFER_COMPLETE) {
+    std::cout << "ERROR::VIRTUAL_TEXTURE::FEEDBACK_INCOMPLETE" << std::endl;
+  }
+
+  glCreateBuffers(2, readback_);
+  for (GLuint buffer : readback_) {
+    glNamedBufferStorage(buffer,
+                         static_cast<GLsizeiptr>(feedback_width) *
+                             feedback_height * sizeof(uint32_t),
+                         nullptr, GL_MAP_READ_BIT);
+  }
+
+  // The whole texture in one page, never evicted so there is always something
+  // to fall back to
+  upload(read_page(key(max_mip, 0, 0)), true);
+  dirty.clear();
+  refresh_table(key(max_mip, 0, 0));
+}
+
+VirtualTexture::~VirtualTexture() {
+  stopping = true;
+  for (GLsync fence : readback_fence_) {
+    if (fence) {
+      glDeleteSync(fence);
+    }
+  }
+  glDeleteBuffers(2, readback_);
+  glDeleteFramebuffers(1, &fbo_);
+  glDeleteRenderbuffers(1, &depth_);
+  glDeleteTextures(1, &feedback_);
+  glDeleteTextures(1, &page_table_);
+  glDeleteTextures(1, &cache_);
+}
+
+VirtualTexture::PageData VirtualTexture::read_page(uint32_t page) const {
+  PageData data{page, std::vector<unsigned char>(
+                          static_cast<size_t>(slot_size) * slot_size * 4)};
+  source.read(key_mip(page), key_x(page) * page_size - border,
+              key_y(page) * page_size - border, slot_size, data.texels.data());
+  return data;
+}
+
+void VirtualTexture::request(uint32_t page) {
+  in_flight.insert(page);
+  pool.submit([this, page] {
+    PageData data = read_page(page);
+    while (!finished.try_push(std::move(data))) {
+      if (stopping) {
+        return;
+      }
+      std::this_thread::yield();
+    }
+  });
+}
+
+int VirtualTexture::acquire_slot() {
+  int victim{-1};
+  for (int i = 0; i < static_cast<int>(slots.size()); ++i) {
+    const Slot &slot = slots[i];
+    if (!slot.used) {
+      return i;
+    }
+    // Pages seen in the latest feedback stay put
+    if (!slot.locked && slot.last_used + 1 < frame_ &&
+        (victim < 0 || slot.last_used < slots[victim].last_used)) {
+      victim = i;
+    }
+  }
+  if (victim >= 0) {
+    resident.erase(slots[victim].key);
+    slots[victim].used = false;
+    dirty.push_back(slots[victim].key);
+  }
+  return victim;
+}
+
+void VirtualTexture::upload(const PageData &page, bool locked) {
+  int index = acquire_slot();
+  if (index < 0) {
+    return; // cache full of pages in use, asked for again next feedback
+  }
+  glTextureSubImage2D(cache_, 0, (index % slots_per_side) * slot_size,
+                      (index / slots_per_side) * slot_size, slot_size,
+                      slot_size, GL_RGBA, GL_UNSIGNED_BYTE,
+                      page.texels.data());
+  slots[index] = {page.key, frame_, true, locked};
+  resident[page.key] = index;
+  dirty.push_back(page.key);
+}
+
+void VirtualTexture::begin_feedback() const {
+  const GLuint none[]{no_page, 0, 0, 0};
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+  glViewport(0, 0, feedback_width, feedback_height);
+  glClearNamedFramebufferuiv(fbo_, GL_COLOR, 0, none);
+  glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTexture::end_feedback(int viewport_width, int viewport_height) {
+  int index = readback_next;
+  if (readback_fence_[index]) {
+    glDeleteSync(readback_fence_[index]); // never got read, newer data wins
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback_[index]);
+  glReadPixels(0, 0, feedback_width, feedback_height, GL_RED_INTEGER,
+               GL_UNSIGNED_INT, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  readback_fence_[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  readback_next ^= 1;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(0, 0, viewport_width, viewport_height);
+}
+
+void VirtualTexture::process_feedback(std::span<const uint32_t> feedback,
+                                      std::vector<uint32_t> &wanted) {
+  std::unordered_set<uint32_t> seen;
+  for (uint32_t page : feedback) {
+    if (page == no_page || !seen.insert(page).second) {
+      continue;
+    }
+    // A page and its whole parent chain, parents are the fallback
+    int mip = key_mip(page), x = key_x(page), y = key_y(page);
+    for (; mip <= max_mip; ++mip, x /= 2, y /= 2) {
+      uint32_t k = key(mip, x, y);
+      if (auto it = resident.find(k); it != resident.end()) {
+        slots[it->second].last_used = frame_;
+      } else if (!in_flight.contains(k)) {
+        wanted.push_back(k);
+      }
+    }
+  }
+}
+
+void VirtualTexture::update(size_t max_uploads, size_t max_in_flight) {
+  // Oldest readback first, only if the GPU is done with it
+  std::vector<uint32_t> wanted;
+  int index = readback_next;
+  if (readback_fence_[index] &&
+      glClientWaitSync(readback_fence_[index], 0, 0) != GL_TIMEOUT_EXPIRED) {
+    glDeleteSync(readback_fence_[index]);
+    readback_fence_[index] = nullptr;
+    size_t count = static_cast<size_t>(feedback_width) * feedback_height;
+    auto data = static_cast<const uint32_t *>(glMapNamedBufferRange(
+        readback_[index], 0, count * sizeof(uint32_t), GL_MAP_READ_BIT));
+    if (data) {
+      process_feedback({data, count}, wanted);
+      glUnmapNamedBuffer(readback_[index]);
+    }
+  }
+
+  // Coarse pages first so something sensible shows up quickly
+  std::sort(wanted.begin(), wanted.end(), std::greater<>());
+  wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+  for (uint32_t page : wanted) {
+    if (in_flight.size() >= max_in_flight) {
+      break;
+    }
+    request(page);
+  }
+
+  for (size_t i = 0; i < max_uploads; ++i) {
+    std::optional<PageData> page = finished.try_pop();
+    if (!page) {
+      break;
+    }
+    in_flight.erase(page->key);
+    upload(*page, false);
+  }
+
+  // Coarse pages first, a page whose parent is refreshed as well is covered
+  std::sort(dirty.begin(), dirty.end(), std::greater<>());
+  dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+  std::unordered_set<uint32_t> refreshed;
+  for (uint32_t page : dirty) {
+    bool covered{false};
+    int mip = key_mip(page), x = key_x(page), y = key_y(page);
+    while (!covered && ++mip <= max_mip) {
+      x /= 2;
+      y /= 2;
+      covered = refreshed.contains(key(mip, x, y));
+    }
+    if (!covered) {
+      refresh_table(page);
+      refreshed.insert(page);
+    }
+  }
+  dirty.clear();
+  ++frame_;
+}
+
+uint32_t VirtualTexture::table_entry(int mip, int x, int y) const {
+  if (auto it = resident.find(key(mip, x, y)); it != resident.end()) {
+    auto sx = static_cast<uint32_t>(it->second % slots_per_side);
+    auto sy = static_cast<uint32_t>(it->second / slots_per_side);
+    return sx | sy << 8 | static_cast<uint32_t>(mip) << 16 | 0xFFu << 24;
+  }
+  // Missing pages inherit their parent's entry
+  if (mip < max_mip) {
+    int parent_side = pages >> (mip + 1);
+    return table[mip + 1][static_cast<size_t>(y / 2) * parent_side + x / 2];
+  }
+  return 0;
+}
+
+void VirtualTexture::refresh_table(uint32_t page) {
+  int top = key_mip(page);
+  GLint row_length;
+  glGetIntegerv(GL_UNPACK_ROW_LENGTH, &row_length);
+  for (int mip = top; mip >= 0; --mip) {
+    int side = pages >> mip;
+    int extent = 1 << (top - mip);
+    int x0 = key_x(page) << (top - mip), y0 = key_y(page) << (top - mip);
+    std::vector<uint32_t> &level = table[mip];
+    for (int y = y0; y < y0 + extent; ++y) {
+      for (int x = x0; x < x0 + extent; ++x) {
+        level[static_cast<size_t>(y) * side + x] = table_entry(mip, x, y);
+      }
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, side);
+    glTextureSubImage2D(page_table_, mip, x0, y0, extent, extent,
+                        GL_RGBA_INTEGER, GL_UNSIGNED_BYTE,
+                        level.data() + static_cast<size_t>(y0) * side + x0);
+  }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+}
+
+void VirtualTexture::bind(const Program &program, GLuint table_unit,
+                          GLuint cache_unit) const {
+  glBindTextureUnit(table_unit, page_table_);
+  glBindTextureUnit(cache_unit, cache_);
+  auto location = [&](const char *name) {
+    return glGetUniformLocation(program, name);
+  };
+  glProgramUniform1i(program, location("vt_page_table"),
+                     static_cast<GLint>(table_unit));
+  glProgramUniform1i(program, location("vt_cache"),
+                     static_cast<GLint>(cache_unit));
+  glProgramUniform1f(program, location("vt_size"),
+                     static_cast<float>(source.size()));
+  glProgramUniform1f(program, location("vt_page_size"),
+                     static_cast<float>(page_size));
+  glProgramUniform1f(program, location("vt_border"),
+                     static_cast<float>(border));
+  glProgramUniform1f(program, location("vt_slot_size"),
+                     static_cast<float>(slot_size));
+  glProgramUniform1f(program, location("vt_cache_size"),
+                     static_cast<float>(slot_size * slots_per_side));
+  glProgramUniform1i(program, location("vt_max_mip"), max_mip);
+  glProgramUniform1f(program, location("vt_feedback_bias"), feedback_bias);
+}
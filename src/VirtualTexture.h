@@ -0,0 +1,156 @@
+#ifndef OPENGLTEMPL_VIRTUALTEXTURE_H
+#define OPENGLTEMPL_VIRTUALTEXTURE_H
+
+#include <glad/glad.h>
+
+#include "Image.h"
+#include "LockFreeQueue.h"
+#include "Program.h"
+#include "TextureFile.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Where virtual texture pages come from. The virtual texture is square with a
+// power of two size and every mip level down to one page must be readable.
+class PageSource {
+public:
+  virtual ~PageSource() = default;
+  virtual int size() const = 0;
+  // Writes an extent x extent RGBA8 tile of the given level whose top left
+  // texel is (x, y). Texels outside the level are clamped to its edge.
+  virtual void read(int mip, int x, int y, int extent,
+                    unsigned char *rgba) const = 0;
+};
+
+// Pages cut out of a decoded image, see generate_mips().
+class ImagePageSource final : public PageSource {
+private:
+  const Image &image;
+
+public:
+  explicit ImagePageSource(const Image &source) : image(source) {}
+  int size() const override { return image.width; }
+  void read(int mip, int x, int y, int extent,
+            unsigned char *rgba) const override;
+};
+
+// Pages read straight from an uncompressed TextureCache entry, so only the
+// pages touched are ever paged in from disk.
+class TextureFilePageSource final : public PageSource {
+private:
+  TextureFile file;
+
+public:
+  explicit TextureFilePageSource(TextureFile source) : file(std::move(source)) {}
+  int size() const override { return static_cast<int>(file.header().width); }
+  void read(int mip, int x, int y, int extent,
+            unsigned char *rgba) const override;
+};
+
+// Software virtual texturing on plain GL 4.6. A fixed size physical cache
+// holds bordered pages, an RGBA8UI page table (one level per virtual mip)
+// points every virtual page at the finest resident copy, and a low resolution
+// feedback pass reports which pages the frame wanted. Missing pages are read
+// by worker threads and uploaded a few per frame, the least recently seen
+// pages make room. The coarsest page is always resident as a fallback.
+class VirtualTexture {
+private:
+  struct PageData {
+    uint32_t key{};
+    std::vector<unsigned char> texels;
+  };
+
+  struct Slot {
+    uint32_t key{};
+    uint64_t last_used{};
+    bool used{false};
+    bool locked{false};
+  };
+
+  const PageSource &source;
+  int page_size, border, slot_size, slots_per_side;
+  int pages, max_mip;
+  int feedback_width, feedback_height;
+  float feedback_bias;
+
+  GLuint cache_{}, page_table_{};
+  GLuint fbo_{}, feedback_{}, depth_{};
+  GLuint readback_[2]{};
+  GLsync readback_fence_[2]{};
+  int readback_next{0};
+
+  std::vector<Slot> slots;
+  std::unordered_map<uint32_t, int> resident;
+  std::unordered_set<uint32_t> in_flight;
+  std::vector<std::vector<uint32_t>> table;
+  // Pages made resident or evicted since the page table was last written
+  std::vector<uint32_t> dirty;
+  uint64_t frame_{1};
+
+  LockFreeQueue<PageData> finished;
+  std::atomic<bool> stopping{false};
+  // Declared last so workers are joined before anything they touch goes away
+  ThreadPool pool;
+
+  static uint32_t key(int mip, int x, int y) {
+    return static_cast<uint32_t>(mip) << 24 | static_cast<uint32_t>(y) << 12 |
+           static_cast<uint32_t>(x);
+  }
+  static int key_mip(uint32_t k) { return static_cast<int>(k >> 24); }
+  static int key_y(uint32_t k) { return static_cast<int>(k >> 12 & 0xFFF); }
+  static int key_x(uint32_t k) { return static_cast<int>(k & 0xFFF); }
+
+  PageData read_page(uint32_t page) const;
+  void request(uint32_t page);
+  int acquire_slot();
+  void upload(const PageData &page, bool locked);
+  void process_feedback(std::span<const uint32_t> feedback,
+                        std::vector<uint32_t> &wanted);
+  uint32_t table_entry(int mip, int x, int y) const;
+  // Rewrites and uploads the entries under one page in every level, all that
+  // a change to that page can affect
+  void refresh_table(uint32_t page);
+
+public:
+  // feedback_divisor shrinks the feedback target relative to the screen,
+  // cache_slots is the number of pages per side of the physical cache.
+  VirtualTexture(const PageSource &page_source, int screen_width,
+                 int screen_height, int feedback_divisor = 8,
+                 int cache_slots = 16, int page = 128, int page_border = 4,
+                 size_t workers = 2);
+  ~VirtualTexture();
+
+  VirtualTexture(const VirtualTexture &) = delete;
+  VirtualTexture &operator=(const VirtualTexture &) = delete;
+
+  // Draw the scene with a program using feedback_fragment between these two.
+  void begin_feedback() const;
+  void end_feedback(int viewport_width, int viewport_height);
+
+  // Reads back older feedback, streams pages and refreshes the page table.
+  // Call once a frame on the GL thread.
+  void update(size_t max_uploads = 8, size_t max_in_flight = 64);
+
+  // Binds the page table and cache and points the vt_ uniforms of program at
+  // them, the program needn't be in use.
+  void bind(const Program &program, GLuint table_unit, GLuint cache_unit) const;
+
+  size_t resident_pages() const { return resident.size(); }
+  size_t cache_pages() const { return slots.size(); }
+
+  // Paste after #version (Program::with_snippet) in any shader that samples
+  // with vt_sample(uv), main's fragment shader does so for MATERIAL_VIRTUAL.
+  static const std::string glsl;
+  // Fragment shader for the feedback pass, expects `in vec2 tex_coord`.
+  static const std::string feedback_fragment;
+};
+
+#endif // OPENGLTEMPL_VIRTUALTEXTURE_H
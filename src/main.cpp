@@ -10,26 +10,49 @@
 #include <iostream>
 #include <vector>
 
+#include "BatchRenderer.h"
 #include "Camera.h"
+#include "CullingPass.h"
+#include "GeometryArena.h"
+#include "HiZPyramid.h"
+#include "ImageDecoder.h"
 #include "IndexBuffer.h"
+#include "InstanceBatcher.h"
+#include "MaterialPacker.h"
 #include "Program.h"
+#include "ResidencyManager.h"
+#include "StreamBuffer.h"
 #include "Texture.h"
+#include "TextureArray.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
+#include "UploadScheduler.h"
+#include "Vertex.h"
 #include "VertexArray.h"
 #include "VertexBuffer.h"
+#include "VertexPacking.h"
+#include "VertexPuller.h"
+#include "VirtualTexture.h"
+#include <bit>
 #include <cstddef>
 #include <cstdlib>
+#include <memory>
+#include <optional>
+#include <variant>
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-struct Vertex {
-    glm::vec3 position;
-    glm::vec3 color;
-    glm::vec2 tex_coords;
-    glm::vec3 normal;
-};
-struct Vertex2 {
-    glm::vec3 position;
+// std140 mirror of the Frame uniform block, vec3s padded to vec4. Per-object
+// data comes from InstanceBatcher's DrawData.
+struct FrameBlock {
+    glm::mat4 camera;
+    glm::vec4 camera_pos;
+    glm::vec4 light_color;
+    glm::vec4 light_pos;
+    glm::float32 a;
+    glm::float32 b;
+    glm::int32 scale;
 };
 
 const std::string &vertexShaderSource = R"(
@@ -39,18 +62,28 @@ const std::string &vertexShaderSource = R"(
     layout (location = 2) in vec2 tex_coords;
     layout (location = 3) in vec3 normal;
 
-    uniform mat4 model;
-    uniform mat4 camera;
-    uniform int scale;
+    layout (std140, binding = 0) uniform Frame {
+        mat4 camera;
+        vec4 camera_pos;
+        vec4 light_color;
+        vec4 light_pos;
+        float a;
+        float b;
+        int scale;
+    };
 
     out vec3 frag_color;
     out vec2 tex_coord;
 
     out vec3 Normal;
     out vec3 crntPos;
+    flat out uint material;
+    // The depth prepass computes positions the same way, so their depths match exactly
+    invariant gl_Position;
     
     void main() {
-        crntPos = vec3(model * vec4(position, 1.0f));
+        crntPos = vec3(draw_data().model * vec4(position, 1.0f));
+        material = draw_data().material;
         gl_Position = camera * vec4(crntPos, 1.0);
         frag_color = color;
         tex_coord = tex_coords * scale;
@@ -65,21 +98,32 @@ const std::string &fragmentShaderSource = R"(
     in vec3 Normal;
     in vec3 crntPos;
 
+#ifdef MATERIAL_ARRAY
+    // One layer per material, picked by the draw's DrawData
+    uniform sampler2DArray materials;
+    flat in uint material;
+#else
     uniform sampler2D diff_0;
+#endif
+#ifndef MATERIAL_SPECULAR_IN_ALPHA
     uniform sampler2D spec_0;
-    uniform vec4 light_color;
-    uniform vec3 light_pos;
-    uniform vec3 camera_pos;
-    
-    // lighting function
-    uniform float a;
-    uniform float b;
+#endif
+    // a and b shape the light falloff
+    layout (std140, binding = 0) uniform Frame {
+        mat4 camera;
+        vec4 camera_pos;
+        vec4 light_color;
+        vec4 light_pos;
+        float a;
+        float b;
+        int scale;
+    };
 
     out vec4 color;
 
 
     vec4 point_light() {
-        vec3 lightVec = light_pos - crntPos;
+        vec3 lightVec = light_pos.xyz - crntPos;
         float dist = length(lightVec);
 
         float inten = 1 / ((a * dist + b) * dist + 1);
@@ -92,12 +136,25 @@ const std::string &fragmentShaderSource = R"(
         float diffuse = max(dot(normal, light_direction), 0);
 
         float spec_light = 0.5;
-        vec3 view_direction = normalize(camera_pos - crntPos);
+        vec3 view_direction = normalize(camera_pos.xyz - crntPos);
         vec3 reflection = reflect(-light_direction, normal);
         float spec_amount = pow(max(dot(view_direction, reflection), 0), 8);
         float specular = spec_light * spec_amount;
 
-        return (texture(diff_0, tex_coord) * (diffuse * inten + ambient) + texture(spec_0, tex_coord).r * specular*inten) * light_color;
+#ifdef MATERIAL_VIRTUAL
+        vec4 diffuse_map = vt_sample(tex_coord);
+#elif defined(MATERIAL_ARRAY)
+        vec4 diffuse_map = texture(materials, vec3(tex_coord, float(material)));
+#else
+        vec4 diffuse_map = texture(diff_0, tex_coord);
+#endif
+#ifdef MATERIAL_SPECULAR_IN_ALPHA
+        float specular_map = diffuse_map.a;
+        diffuse_map.a = 1.0;
+#else
+        float specular_map = texture(spec_0, tex_coord).r;
+#endif
+        return (diffuse_map * (diffuse * inten + ambient) + specular_map * specular*inten) * light_color;
     }
 
 //    vec4 direct_light() {
@@ -153,11 +210,38 @@ const std::string &light_vert = R"(
     #version 460 core
     layout (location = 0) in vec3 position;
 
-    uniform mat4 model;
-    uniform mat4 camera;
+    // Leading members of the main program's block, same buffer. Both stages
+    // have to declare it alike.
+    layout (std140, binding = 0) uniform Frame {
+        mat4 camera;
+        vec4 camera_pos;
+        vec4 light_color;
+    };
+
+    void main() {
+        gl_Position = camera * draw_data().model * vec4(position, 1.0);
+    }
+)";
+
+// Depth prepass, positions only and pulled by the shader itself. Same Frame block as light_vert.
+const std::string &depth_vert = R"(
+    #version 460 core
+
+    layout (std140, binding = 0) uniform Frame {
+        mat4 camera;
+    };
+    invariant gl_Position;
+
+    void main() {
+        vec3 crntPos = vec3(pulled_draw().model * vec4(pulled_vertex().position, 1.0f));
+        gl_Position = camera * vec4(crntPos, 1.0);
+    }
+)";
+
+const std::string &depth_frag = R"(
+    #version 460 core
 
     void main() {
-        gl_Position = camera * model * vec4(position, 1.0);
     }
 )";
 
@@ -165,10 +249,14 @@ const std::string &light_frag = R"(
     #version 460 core
 
     out vec4 color;
-    uniform vec4 in_color;
+    layout (std140, binding = 0) uniform Frame {
+        mat4 camera;
+        vec4 camera_pos;
+        vec4 light_color;
+    };
 
     void main() {
-        color = in_color;
+        color = light_color;
     }
 )";
 
@@ -215,30 +303,92 @@ int main(int, char **) {
   glGetIntegerv(GL_MINOR_VERSION, &OpenGLVersion[1]);
 
   std::cout << "OpenGL Version: " << OpenGLVersion[0] << '.' << OpenGLVersion[1] << std::endl;
-  stbi_set_flip_vertically_on_load(true);
-
-  Program program = Program(window, vertexShaderSource, fragmentShaderSource);
-  Program light_program = Program(window, light_vert, light_frag);
-
-
-  GLfloat vertices[] = {
-          //     COORDINATES     /        COLORS        /    TexCoord    / NORMALS
-          //     //
-          -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
-          1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f,
-          0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f};
-  GLuint indices[] = {0, 1, 2, 0, 2, 3};
-  Attribute attributes[] = {{0, 0,                   {GL_FLOAT, 3}},
-                            {1, sizeof(GLfloat) * 3, {GL_FLOAT, 3}},
-                            {2, sizeof(GLfloat) * 6, {GL_FLOAT, 2}},
-                            {3, sizeof(GLfloat) * 8, {GL_FLOAT, 3}}};
-  Texture tex0{"assets/planks.png", GL_RGBA, Texture::TextureType::DIFFUSE};
-  Texture tex1{"assets/planksSpec.png", GL_RED, Texture::TextureType::SPECULAR};
-  Texture textures[]{tex0, tex1};
-
-  VertexBuffer<GLfloat> v_buffer{vertices, sizeof(GLfloat) * 11};
-  IndexBuffer<GLuint> i_buffer{indices};
-  VertexArray floor{v_buffer, i_buffer, attributes, textures};
+  set_flip_vertically_on_load(true);
+
+  // Specular only, so it rides in the diffuse alpha and the shader skips spec_0
+  const MaterialPaths planks{"assets/planks.png", "assets/planksSpec.png", "", ""};
+  MaterialLayout planks_layout = material_layout(planks);
+  Program program = Program(window, Program::with_snippet(vertexShaderSource, BatchRenderer::glsl),
+                            Program::with_defines(fragmentShaderSource, planks_layout.defines()));
+  Program light_program = Program(window, Program::with_snippet(light_vert, BatchRenderer::glsl), light_frag);
+  // The same material paged through a virtual texture, plus the pass telling it which pages are seen
+  std::vector<std::string> virtual_defines = planks_layout.defines();
+  virtual_defines.emplace_back("MATERIAL_VIRTUAL");
+  Program virtual_program = Program(window, Program::with_snippet(vertexShaderSource, BatchRenderer::glsl),
+                                    Program::with_defines(Program::with_snippet(fragmentShaderSource,
+                                                                                VirtualTexture::glsl),
+                                                          virtual_defines));
+  Program feedback_program = Program(window, Program::with_snippet(vertexShaderSource, BatchRenderer::glsl),
+                                     VirtualTexture::feedback_fragment);
+  Program depth_program = Program(window, Program::with_snippet(depth_vert, VertexPuller::glsl), depth_frag);
+  // Tiles whose materials are layers of one TextureArray, specular in alpha
+  const std::vector<std::string> array_defines{"MATERIAL_ARRAY", "MATERIAL_SPECULAR_IN_ALPHA"};
+  Program array_program = Program(window, Program::with_snippet(vertexShaderSource, BatchRenderer::glsl),
+                                  Program::with_defines(fragmentShaderSource, array_defines));
+
+
+  Vertex vertices[] = {//     COORDINATES     /        COLORS        /    TexCoord    / NORMALS
+          {{-1.0f, 0.0f, 1.0f},  {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+          {{-1.0f, 0.0f, -1.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}},
+          {{1.0f,  0.0f, -1.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f, 0.0f}},
+          {{1.0f,  0.0f, 1.0f},  {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f}, {0.0f, 1.0f, 0.0f}}};
+  const GLuint indices[] = {0, 1, 2, 0, 2, 3};
+  // Few enough vertices for GLushort, narrow_indices() checks both that and the range
+  std::optional<NarrowIndices> floor_indices = narrow_indices(indices, std::size(vertices));
+  if (!floor_indices) {
+    return EXIT_FAILURE;
+  }
+  auto &floor_index_data = std::get<std::vector<GLushort>>(*floor_indices);
+  // 20 instead of 44 bytes a vertex, the dequantization rides in the model matrix
+  QuantizedMesh floor_mesh = quantize(vertices);
+  std::cout << "Floor quantization error: position " << floor_mesh.error.position << ", normal "
+            << floor_mesh.error.normal << ", uv " << floor_mesh.error.tex_coords << std::endl;
+  UploadScheduler uploader{};
+  TextureCache texture_cache{"cache"};
+  TextureLoader loader{&uploader, &texture_cache};
+  Texture textures[]{Texture{Texture::TextureType::DIFFUSE},
+                     Texture{Texture::TextureType::SPECULAR}};
+  ResidencyManager residency{loader, 256 << 20};
+  for (Texture &texture : textures) {
+    residency.track(texture);
+  }
+  loader.load_material(textures[0], &textures[1], planks, true);
+
+  // Pages come straight out of the uncompressed cache entry of the packed material, once the loader has written
+  // it. Virtual textures need a square power of two source.
+  std::unique_ptr<TextureFilePageSource> virtual_pages;
+  std::unique_ptr<VirtualTexture> virtual_floor;
+  loader.load_file(Texture::TextureType::DIFFUSE, planks.diffuse, [&](TextureFile file) {
+      if (!file.valid() || file.compressed() || file.level_width(0) != file.level_height(0) ||
+          !std::has_single_bit(static_cast<unsigned>(file.level_width(0))) || file.level_width(0) < 128) {
+        return;
+      }
+      virtual_pages = std::make_unique<TextureFilePageSource>(std::move(file));
+      virtual_floor = std::make_unique<VirtualTexture>(*virtual_pages, width, height);
+  }, {planks.diffuse, planks.specular});
+
+  // Square power of two images of at least tile_size become layers as the loader finishes them, larger ones skip
+  // their top levels. Anything else is skipped.
+  constexpr int tile_size = 512;
+  TextureArray materials{GL_RGBA8, tile_size, tile_size, std::bit_width(static_cast<unsigned>(tile_size)), 3};
+  for (const char *path : {"assets/pop_cat.png", "assets/planksSpec.png", "assets/osugo.jpg"}) {
+    loader.load_file(Texture::TextureType::DIFFUSE, path, [&materials](TextureFile file) { materials.add(file); });
+  }
+  // The array sits on a unit of its own, bound once
+  materials.bind(6);
+  glProgramUniform1i(array_program, glGetUniformLocation(array_program, "materials"), 6);
+
+  // Formats come from the VertexLayouts in Vertex.h, one VAO per layout
+  VertexArrayCache layouts;
+  VertexBuffer<PackedVertex> v_buffer{floor_mesh.vertices, sizeof(PackedVertex)};
+  IndexBuffer<GLushort> i_buffer{floor_index_data};
+  VertexArray floor{layouts, v_buffer, i_buffer,
+                    std::span<Texture>{textures, planks_layout.scalar_map ? 2u : 1u}};
+  // The tiles import the same quad as two streams. The depth prepass pulls the positions from a VertexPuller instead.
+  SplitMesh tile_mesh = split_vertices(vertices);
+  VertexBuffer<Vertex2> tile_positions{tile_mesh.positions};
+  VertexBuffer<VertexAttributes> tile_attributes{tile_mesh.attributes};
+  VertexArray tiles{tile_positions, tile_attributes, i_buffer, {}};
 
 
   Vertex2 lightVertices[] = {//     COORDINATES     //
@@ -254,12 +404,14 @@ int main(int, char **) {
   GLuint lightIndices[] = {0, 1, 2, 0, 2, 3, 0, 4, 7, 0, 7, 3, 3, 7, 6, 3, 6, 2, 2, 6, 5, 2, 5, 1, 1, 5, 4, 1, 4, 0, 4,
                            5, 6, 4, 6, 7};
 
-  Attribute light_attr[] = {{0, offsetof(Vertex2, position), {GL_FLOAT, 3}}};
-  VertexBuffer<Vertex2> light_vertices{lightVertices, sizeof(Vertex2)};
-  IndexBuffer<GLuint> light_indices{lightIndices};
-  VertexArray light_cube{light_vertices, light_indices, light_attr, {}};
+  // Position only meshes live in one arena and go out as a single multi-draw
+  GeometryArena light_geometry{VertexLayout<Vertex2>::attributes, sizeof(Vertex2), 64u << 10, 64u << 10};
+  MeshRange light_cube = light_geometry.add(std::span<const Vertex2>{lightVertices},
+                                            std::span<const GLuint>{lightIndices});
   glm::vec4 light_color{1.0f, 1.0f, 1.0f, 1.0f};
   glm::vec3 light_pos = glm::vec3(0.5, 0.5, 0.5);
+  // Bounding sphere radius, the light model only moves and turns the cube
+  const float light_radius = glm::length(lightVertices[0].position);
 
   Camera camera(width, height, glm::vec3(0.0f, 0.5f, 2.0f));
 
@@ -270,6 +422,8 @@ int main(int, char **) {
   glfwSetFramebufferSizeCallback(window, resizing);
 
   bool foo = true;
+  bool use_virtual = false;
+  bool draw_tiles = true;
   bool uniform = true;
   bool rotate = true;
   glm::float32 t{};
@@ -282,10 +436,14 @@ int main(int, char **) {
   glm::float32 a{3};
   glm::float32 b{0.7};
 
-  GLint tex_location = glGetUniformLocation(program, "tex");
-  GLint scale_location = glGetUniformLocation(program, "scale");
-  GLint model_location = glGetUniformLocation(program, "model");
-  GLint lmodel_location = glGetUniformLocation(light_program, "model");
+  // Frame uniforms and per-object transforms, written each frame with no copies
+  StreamBuffer stream{};
+  InstanceBatcher batcher{stream};
+  VertexPuller pulled{stream, 64u << 10, 64u << 10};
+  PulledMesh pulled_tile = pulled.add(std::span<const Vertex2>{tile_mesh.positions}, std::span<const GLuint>{indices});
+  // The light cube is culled on the GPU, against the frustum and last frame's depth, and drawn from what survives
+  CullingPass light_culling{1};
+  std::unique_ptr<HiZPyramid> hiz;
 
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
@@ -296,13 +454,23 @@ int main(int, char **) {
   ImGui_ImplOpenGL3_Init("#version 460");
   // glEnable(GL_FRAMEBUFFER_SRGB); // Gamma correction
   glEnable(GL_DEPTH_TEST);
+  // Equal depths pass, so shading after the depth prepass keeps the fragments it laid down
+  glDepthFunc(GL_LEQUAL);
   while (!glfwWindowShouldClose(window)) {
+    loader.poll();
+    uploader.frame();
+    stream.begin_frame();
+    batcher.begin_frame();
+
     // Create Imgui
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
 
     ImGui::NewFrame();
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+    ImGui::Text("Texture upload %zu / %zu bytes", uploader.last_frame_bytes(), uploader.budget_bytes());
+    ImGui::Text("Texture memory %zu / %zu bytes", residency.resident_bytes(), residency.budget_bytes());
+    ImGui::Text("Draw calls %zu", batcher.last_draw_calls());
     ImGui::SliderInt("Tex Scale", &scalar, 1, 10);
     ImGui::SliderInt("Fov", &fov, 1, 180);
     ImGui::SliderFloat3("Light Pos", glm::value_ptr(light_pos), -5, 5);
@@ -314,6 +482,11 @@ int main(int, char **) {
     ImGui::SliderFloat("zFar", &z_far, 0, 100);
 
     ImGui::Checkbox("Draw Shape?", &foo);
+    if (virtual_floor) {
+      ImGui::Checkbox("Virtual texture?", &use_virtual);
+      ImGui::Text("Virtual pages %zu / %zu", virtual_floor->resident_pages(), virtual_floor->cache_pages());
+    }
+    ImGui::Checkbox("Material array tiles?", &draw_tiles);
     ImGui::Checkbox("Update Uniform?", &uniform);
     ImGui::ColorPicker4("Background Color: ", glm::value_ptr(bg), ImGuiColorEditFlags_PickerHueWheel);
     ImGui::SliderFloat("Light: Param A", &a, 0, 3);
@@ -329,26 +502,73 @@ int main(int, char **) {
     camera.update_matrix(glm::radians(static_cast<float>(fov)), z_near, z_far);
     camera.inputs(window);
 
+    int framebuffer_width, framebuffer_height;
+    glfwGetFramebufferSize(window, &framebuffer_width, &framebuffer_height);
+
     // Drawing
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glClearColor(bg[0], bg[1], bg[2], bg[3]);
     if (foo) {
-      glUseProgram(program);
-      glUniform1i(scale_location, scalar);
-      glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(model));
-      glUniform4fv(glGetUniformLocation(program, "light_color"), 1, glm::value_ptr(light_color));
-      glUniform3fv(glGetUniformLocation(program, "light_pos"), 1, glm::value_ptr(light_pos));
-      glUniform1f(glGetUniformLocation(program, "a"), a);
-      glUniform1f(glGetUniformLocation(program, "b"), b);
-      glUniform3fv(glGetUniformLocation(program, "camera_pos"), 1, glm::value_ptr(camera.position));
-      floor.draw(program, camera);
-
-
-      glUseProgram(light_program);
-      glUniformMatrix4fv(glGetUniformLocation(light_program, "model"), 1, GL_FALSE, glm::value_ptr(light_model));
-      glUniform4fv(glGetUniformLocation(light_program, "in_color"), 1, glm::value_ptr(light_color));
-      light_cube.draw(light_program, camera);
+      stream.bind_uniform(0, stream.uniform(FrameBlock{camera.camera_matrix, glm::vec4(camera.position, 1.0f),
+                                                       light_color, glm::vec4(light_pos, 1.0f), a, b, scalar}));
+
+      auto tile_model = [&](GLsizei layer) {
+          glm::vec3 offset{(static_cast<float>(layer) - (materials.layers() - 1) * 0.5f) * 2.0f, 0.0f, -2.0f};
+          return glm::translate(model, offset);
+      };
+      if (draw_tiles) {
+        // Depth only first, the shading pass below then runs once per covered pixel
+        for (GLsizei layer = 0; layer < materials.layers(); ++layer) {
+          pulled.add_draw(pulled_tile, tile_model(layer));
+        }
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glUseProgram(depth_program);
+        pulled.submit();
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+      }
+
+      glm::mat4 floor_model = model * floor_mesh.dequantize();
+      if (virtual_floor && use_virtual) {
+        // Feedback for the pages this frame sees, read back a frame or two later
+        virtual_floor->bind(feedback_program, 4, 5);
+        virtual_floor->begin_feedback();
+        batcher.submit(floor, feedback_program, floor_model);
+        batcher.flush();
+        virtual_floor->end_feedback(framebuffer_width, framebuffer_height);
+        virtual_floor->update();
+        virtual_floor->bind(virtual_program, 4, 5);
+      }
+
+      batcher.submit(floor, virtual_floor && use_virtual ? virtual_program : program, floor_model);
+      if (draw_tiles) {
+        // Different materials, same program and VAO, so still one draw
+        for (GLsizei layer = 0; layer < materials.layers(); ++layer) {
+          batcher.submit(tiles, array_program, tile_model(layer), static_cast<GLuint>(layer));
+        }
+      }
+      batcher.flush();
+      DrawData light_draw{light_model, 0, {}};
+      StreamBuffer::Slice light_slice = stream.storage(std::span<const DrawData>{&light_draw, 1});
+      if (light_slice.valid()) {
+        CullObject light_object = CullObject::from(light_cube, glm::vec4(light_pos, light_radius), 0);
+        light_culling.set_objects(std::span<const CullObject>{&light_object, 1});
+        light_culling.cull(camera.camera_matrix, hiz.get());
+        stream.bind_storage(BatchRenderer::draw_binding, light_slice);
+        glUseProgram(light_program);
+        light_culling.draw(light_geometry);
+      }
+
+      // Next frame's occlusion test reads this frame's depth
+      if (framebuffer_width > 0 && framebuffer_height > 0) {
+        if (!hiz || hiz->width() != framebuffer_width || hiz->height() != framebuffer_height) {
+          hiz = std::make_unique<HiZPyramid>(framebuffer_width, framebuffer_height);
+        }
+        hiz->capture(camera.camera_matrix);
+      }
     }
+    stream.end_frame();
+
+    residency.end_frame();
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
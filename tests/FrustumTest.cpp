@@ -0,0 +1,70 @@
+// Sphere tests against the planes Frustum extracts from a perspective camera:
+// inside, behind, past the far plane, off to every side, straddling a plane,
+// and spheres just short of and just over the near plane, which only come out
+// right when the planes are normalised.
+
+#include "Frustum.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+int failures{0};
+int checks{0};
+
+void check(bool condition, const char *what) {
+  ++checks;
+  if (!condition) {
+    std::printf("FAILED: %s\n", what);
+    ++failures;
+  }
+}
+
+} // namespace
+
+int main() {
+  // At the origin looking down -z, 90 degrees vertically, square viewport, so
+  // the side planes run at 45 degrees
+  constexpr float z_near = 0.1f;
+  constexpr float z_far = 100.0f;
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  glm::mat4 proj =
+      glm::perspective(glm::radians(90.0f), 1.0f, z_near, z_far);
+  Frustum frustum{proj * view};
+
+  check(frustum.intersects({0.0f, 0.0f, -5.0f, 0.5f}), "sphere ahead culled");
+  check(frustum.intersects({0.0f, 0.0f, -5.0f, 50.0f}),
+        "sphere around the frustum culled");
+  check(!frustum.intersects({0.0f, 0.0f, 5.0f, 0.5f}), "sphere behind kept");
+  check(!frustum.intersects({0.0f, 0.0f, -z_far - 1.0f, 0.5f}),
+        "sphere past the far plane kept");
+  check(frustum.intersects({0.0f, 0.0f, -z_far - 0.4f, 0.5f}),
+        "sphere straddling the far plane culled");
+
+  // At depth 5 the sides are 5 away from the axis
+  check(!frustum.intersects({-7.0f, 0.0f, -5.0f, 1.0f}), "sphere left kept");
+  check(!frustum.intersects({7.0f, 0.0f, -5.0f, 1.0f}), "sphere right kept");
+  check(!frustum.intersects({0.0f, -7.0f, -5.0f, 1.0f}), "sphere below kept");
+  check(!frustum.intersects({0.0f, 7.0f, -5.0f, 1.0f}), "sphere above kept");
+  // 2 / sqrt(2) = 1.41 from the left plane
+  check(frustum.intersects({-7.0f, 0.0f, -5.0f, 1.5f}),
+        "sphere straddling the left plane culled");
+  check(!frustum.intersects({-7.0f, 0.0f, -5.0f, 1.3f}),
+        "sphere just off the left plane kept");
+
+  // Centered 0.6 behind the near plane
+  check(!frustum.intersects({0.0f, 0.0f, 0.5f, 0.59f}),
+        "sphere just short of the near plane kept");
+  check(frustum.intersects({0.0f, 0.0f, 0.5f, 0.61f}),
+        "sphere just over the near plane culled");
+
+  if (failures) {
+    return EXIT_FAILURE;
+  }
+  std::printf("%d spheres, all checks passed\n", checks);
+  return EXIT_SUCCESS;
+}
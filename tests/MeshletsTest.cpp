@@ -0,0 +1,230 @@
+// build_meshlets on grids and a UV sphere, no GL context needed. Checks the
+// vertex and triangle limits, that every triangle lands in exactly one
+// meshlet, the clamp that keeps local indices below the 0xFF sentinel, and
+// that back facing meshlets of a sphere are culled without ever losing a
+// front facing triangle.
+
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <set>
+#include <vector>
+
+namespace {
+
+int failures{0};
+
+void check(bool condition, const char *what, int test) {
+  if (!condition) {
+    std::printf("FAILED in test %d: %s\n", test, what);
+    ++failures;
+  }
+}
+
+struct Mesh {
+  std::vector<glm::vec3> positions;
+  std::vector<GLuint> indices;
+};
+
+// n by n quads in the xz plane
+Mesh grid(int n) {
+  Mesh mesh;
+  for (int z = 0; z <= n; ++z) {
+    for (int x = 0; x <= n; ++x) {
+      mesh.positions.emplace_back(static_cast<float>(x), 0.0f,
+                                  static_cast<float>(z));
+    }
+  }
+  auto at = [n](int x, int z) { return static_cast<GLuint>(z * (n + 1) + x); };
+  for (int z = 0; z < n; ++z) {
+    for (int x = 0; x < n; ++x) {
+      mesh.indices.insert(mesh.indices.end(), {at(x, z), at(x, z + 1),
+                                               at(x + 1, z), at(x + 1, z),
+                                               at(x, z + 1), at(x + 1, z + 1)});
+    }
+  }
+  return mesh;
+}
+
+glm::vec3 normal(const Mesh &mesh, const GLuint *triangle) {
+  glm::vec3 a = mesh.positions[triangle[0]];
+  return glm::cross(mesh.positions[triangle[1]] - a,
+                    mesh.positions[triangle[2]] - a);
+}
+
+// Unit sphere, counter clockwise seen from outside, no degenerate triangles
+Mesh uv_sphere(int stacks, int slices) {
+  Mesh mesh;
+  const float pi = std::acos(-1.0f);
+  for (int i = 0; i <= stacks; ++i) {
+    float theta = pi * static_cast<float>(i) / static_cast<float>(stacks);
+    for (int j = 0; j <= slices; ++j) {
+      float phi =
+          2.0f * pi * static_cast<float>(j) / static_cast<float>(slices);
+      mesh.positions.emplace_back(std::sin(theta) * std::cos(phi),
+                                  std::cos(theta),
+                                  std::sin(theta) * std::sin(phi));
+    }
+  }
+  auto at = [slices](int i, int j) {
+    return static_cast<GLuint>(i * (slices + 1) + j);
+  };
+  auto add = [&](GLuint a, GLuint b, GLuint c) {
+    GLuint triangle[]{a, b, c};
+    glm::vec3 n = normal(mesh, triangle);
+    if (glm::length(n) < 1e-6f) {
+      return;
+    }
+    glm::vec3 centroid =
+        (mesh.positions[a] + mesh.positions[b] + mesh.positions[c]) / 3.0f;
+    if (glm::dot(n, centroid) < 0.0f) {
+      std::swap(triangle[1], triangle[2]);
+    }
+    mesh.indices.insert(mesh.indices.end(), triangle, triangle + 3);
+  };
+  for (int i = 0; i < stacks; ++i) {
+    for (int j = 0; j < slices; ++j) {
+      add(at(i, j), at(i + 1, j), at(i, j + 1));
+      add(at(i, j + 1), at(i + 1, j), at(i + 1, j + 1));
+    }
+  }
+  return mesh;
+}
+
+// A triangle with its smallest index first, winding kept
+std::array<GLuint, 3> canonical(const GLuint *triangle) {
+  std::array<GLuint, 3> t{triangle[0], triangle[1], triangle[2]};
+  std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+  return t;
+}
+
+// Limits, local indices in range and every input triangle exactly once.
+// Returns the largest vertex count of any meshlet.
+size_t check_meshlets(const Mesh &mesh, const MeshletMesh &meshlets,
+                      size_t max_vertices, size_t max_triangles, int test) {
+  std::vector<std::array<GLuint, 3>> expected, found;
+  for (size_t t = 0; t < mesh.indices.size(); t += 3) {
+    expected.push_back(canonical(&mesh.indices[t]));
+  }
+  size_t largest{0};
+  GLuint vertex_end{0}, triangle_end{0};
+  for (const Meshlet &meshlet : meshlets.meshlets) {
+    check(meshlet.vertex_count <= max_vertices, "too many vertices", test);
+    check(meshlet.triangle_count <= max_triangles, "too many triangles",
+          test);
+    check(meshlet.triangle_count > 0, "empty meshlet", test);
+    check(meshlet.vertex_offset == vertex_end &&
+              meshlet.triangle_offset == triangle_end,
+          "meshlet ranges not contiguous", test);
+    vertex_end = meshlet.vertex_offset + meshlet.vertex_count;
+    triangle_end = meshlet.triangle_offset + meshlet.triangle_count;
+    largest = std::max<size_t>(largest, meshlet.vertex_count);
+
+    const GLuint *vertices = &meshlets.vertices[meshlet.vertex_offset];
+    std::set<GLuint> unique(vertices, vertices + meshlet.vertex_count);
+    check(unique.size() == meshlet.vertex_count, "vertex listed twice", test);
+    for (size_t t = 0; t < meshlet.triangle_count; ++t) {
+      const uint8_t *local =
+          &meshlets.triangles[3 * (meshlet.triangle_offset + t)];
+      GLuint triangle[3];
+      for (int k = 0; k < 3; ++k) {
+        check(local[k] < meshlet.vertex_count, "local index out of range",
+              test);
+        triangle[k] = vertices[std::min<GLuint>(local[k],
+                                                meshlet.vertex_count - 1)];
+      }
+      found.push_back(canonical(triangle));
+    }
+  }
+  check(vertex_end == meshlets.vertices.size() &&
+            3 * triangle_end == meshlets.triangles.size(),
+        "meshlets don't cover their arrays", test);
+  std::sort(expected.begin(), expected.end());
+  std::sort(found.begin(), found.end());
+  check(expected == found, "triangles lost or duplicated", test);
+  return largest;
+}
+
+} // namespace
+
+int main() {
+  int test{0};
+
+  // Limits, including ones that don't divide the grid evenly
+  Mesh plane = grid(20);
+  const size_t limits[][2]{{64, 124}, {3, 1}, {4, 2}, {10, 7}, {255, 512}};
+  for (const auto &limit : limits) {
+    ++test;
+    MeshletMesh meshlets = build_meshlets(plane.indices, plane.positions,
+                                          limit[0], limit[1]);
+    check_meshlets(plane, meshlets, limit[0], limit[1], test);
+  }
+
+  // More vertices than a byte indexes. Asked for 1000, meshlets have to stop
+  // at 255 so local indices never reach the 0xFF sentinel.
+  ++test;
+  Mesh big = grid(40);
+  MeshletMesh clamped = build_meshlets(big.indices, big.positions, 1000, 4000);
+  size_t largest = check_meshlets(big, clamped, 255, 4000, test);
+  check(largest > 200, "vertex clamp not what limited the meshlets", test);
+
+  // Back face culling on a sphere
+  ++test;
+  Mesh sphere = uv_sphere(16, 32);
+  MeshletMesh sphere_meshlets =
+      build_meshlets(sphere.indices, sphere.positions, 16, 8);
+  check_meshlets(sphere, sphere_meshlets, 16, 8, test);
+  const Meshlet *tightest{nullptr};
+  for (const Meshlet &meshlet : sphere_meshlets.meshlets) {
+    if (!tightest || meshlet.cone_cutoff < tightest->cone_cutoff) {
+      tightest = &meshlet;
+    }
+  }
+  check(tightest && tightest->cone_cutoff < 1.0f, "no meshlet can be culled",
+        test);
+  if (tightest) {
+    glm::vec3 center{tightest->sphere.x, tightest->sphere.y,
+                     tightest->sphere.z};
+    check(backfacing(*tightest, center - tightest->cone_axis * 10.0f),
+          "meshlet seen from straight behind kept", test);
+    check(!backfacing(*tightest, center + tightest->cone_axis * 10.0f),
+          "meshlet seen from straight ahead culled", test);
+  }
+  // Culled meshlets may only hold back facing triangles, wherever the camera
+  const glm::vec3 cameras[]{{0.0f, 0.0f, 10.0f}, {0.0f, 0.0f, -10.0f},
+                            {10.0f, 0.0f, 0.0f}, {-10.0f, 0.0f, 0.0f},
+                            {0.0f, 10.0f, 0.0f}, {0.0f, -10.0f, 0.0f},
+                            {3.0f, 2.0f, 1.5f},  {0.0f, 0.0f, 1.5f}};
+  size_t culled{0};
+  for (const glm::vec3 &camera : cameras) {
+    for (const Meshlet &meshlet : sphere_meshlets.meshlets) {
+      if (!backfacing(meshlet, camera)) {
+        continue;
+      }
+      ++culled;
+      const GLuint *vertices = &sphere_meshlets.vertices[meshlet.vertex_offset];
+      for (size_t t = 0; t < meshlet.triangle_count; ++t) {
+        const uint8_t *local =
+            &sphere_meshlets.triangles[3 * (meshlet.triangle_offset + t)];
+        GLuint triangle[]{vertices[local[0]], vertices[local[1]],
+                          vertices[local[2]]};
+        glm::vec3 to_triangle = sphere.positions[triangle[0]] - camera;
+        check(glm::dot(normal(sphere, triangle), to_triangle) >= 0.0f,
+              "front facing triangle culled", test);
+      }
+    }
+  }
+  check(culled > 0, "no meshlet culled from any camera", test);
+
+  if (failures) {
+    return EXIT_FAILURE;
+  }
+  std::printf("%d tests, %zu back facing meshlets culled, all checks passed\n",
+              test, culled);
+  return EXIT_SUCCESS;
+}
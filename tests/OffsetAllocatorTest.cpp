@@ -0,0 +1,104 @@
+// Random allocate/free traffic against OffsetAllocator. Checks alignment,
+// bounds, that live ranges never overlap and that byte accounting holds, and
+// that freeing everything coalesces back into one range.
+
+#include "OffsetAllocator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Live {
+  OffsetAllocator::Allocation allocation;
+  uint32_t size;
+};
+
+int failures{0};
+
+void check(bool condition, const char *what, int op) {
+  if (!condition) {
+    std::printf("FAILED at op %d: %s\n", op, what);
+    ++failures;
+  }
+}
+
+void check_live(const OffsetAllocator &allocator, std::vector<Live> live,
+                int op) {
+  std::sort(live.begin(), live.end(), [](const Live &a, const Live &b) {
+    return a.allocation.offset < b.allocation.offset;
+  });
+  uint64_t used{0};
+  for (size_t i = 0; i < live.size(); ++i) {
+    used += live[i].size;
+    if (i > 0) {
+      check(live[i - 1].allocation.offset + live[i - 1].size <=
+                live[i].allocation.offset,
+            "live ranges overlap", op);
+    }
+  }
+  check(used + allocator.free_bytes() == allocator.total_bytes(),
+        "used and free bytes don't add up to the capacity", op);
+}
+
+} // namespace
+
+int main() {
+  constexpr uint32_t capacity = 16u << 20;
+  constexpr int operations = 200000;
+  constexpr uint32_t alignments[]{1, 4, 16, 20, 44, 256};
+  OffsetAllocator allocator{capacity};
+  std::mt19937 rng{1234};
+  std::vector<Live> live;
+
+  for (int op = 0; op < operations; ++op) {
+    // Lean towards allocating until a few thousand ranges are live
+    uint32_t bias = live.size() < 4000 ? 60 : 40;
+    bool allocate = live.empty() || rng() % 100 < bias;
+    if (allocate) {
+      uint32_t size = 1 + rng() % (rng() % 8 == 0 ? 65536 : 512);
+      uint32_t alignment = alignments[rng() % std::size(alignments)];
+      OffsetAllocator::Allocation allocation =
+          allocator.allocate(size, alignment);
+      if (!allocation.valid()) {
+        continue;
+      }
+      check(allocation.offset % alignment == 0, "misaligned offset", op);
+      check(allocation.offset + size <= capacity, "range past the end", op);
+      check(allocator.size(allocation) == size, "wrong allocation size", op);
+      live.push_back({allocation, size});
+    } else {
+      size_t i = rng() % live.size();
+      allocator.free(live[i].allocation);
+      live[i] = live.back();
+      live.pop_back();
+    }
+    if (op % 1000 == 0) {
+      check_live(allocator, live, op);
+    }
+    if (failures) {
+      return EXIT_FAILURE;
+    }
+  }
+  check_live(allocator, live, operations);
+
+  for (const Live &range : live) {
+    allocator.free(range.allocation);
+  }
+  check(allocator.free_bytes() == capacity, "bytes lost after freeing all",
+        operations);
+  check(allocator.largest_free() == capacity,
+        "free ranges didn't coalesce into one", operations);
+  check(allocator.allocate(capacity).valid(),
+        "the whole capacity can't be allocated again", operations);
+
+  if (failures) {
+    return EXIT_FAILURE;
+  }
+  std::printf("%d operations, all checks passed\n", operations);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+// Fills the texture cache ahead of time so the application never has to
+// decode or compress a PNG/JPEG/HDR at startup.
+//
+//   asset_baker <cache dir> <diffuse|specular|normal> <image> [...]
+//   asset_baker <cache dir> material <diffuse>,<specular>[,<roughness>,<ao>]
+//
+// Materials get their scalar maps packed exactly like
+// TextureLoader::load_material() does, empty entries are missing maps.
+//
+// Images are flipped like main.cpp does, entries are only valid for a loader
+// with the same flip setting.
+
+#include "BlockCompression.h"
+#include "HdrImage.h"
+#include "Image.h"
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+#include "MaterialPacker.h"
+#include "MipGenerator.h"
+#include "Texture.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static std::optional<Texture::TextureType> parse_type(const std::string &arg) {
+  if (arg == "diffuse") {
+    return Texture::TextureType::DIFFUSE;
+  }
+  if (arg == "specular") {
+    return Texture::TextureType::SPECULAR;
+  }
+  if (arg == "normal") {
+    return Texture::TextureType::NORMAL;
+  }
+  return std::nullopt;
+}
+
+// Bakes both variants of one texture, several paths make a packed material
+// texture. Returns false on failure.
+static bool bake(const TextureCache &cache, ThreadPool &pool,
+                 Texture::TextureType type,
+                 const std::vector<std::string> &paths) {
+  std::vector<MappedFile> sources;
+  std::string name;
+  for (const std::string &path : paths) {
+    sources.emplace_back(path);
+    name = name.empty() ? path : name;
+  }
+  bool srgb = type == Texture::TextureType::DIFFUSE;
+  Image image;
+  if (paths.size() == 1) {
+    image = sources[0].valid() ? decode_image(sources[0].bytes()) : Image{};
+  } else {
+    std::vector<Image> maps;
+    for (const MappedFile &source : sources) {
+      maps.push_back(source.valid() ? decode_image(source.bytes()) : Image{});
+    }
+    image = pack_material(type, maps);
+  }
+  if (image.empty()) {
+    std::cerr << "ERROR::BAKER::LOAD_FAILED\n" << name << std::endl;
+    return false;
+  }
+  uint64_t hash = TextureCache::hash(sources);
+  generate_mips(image, srgb, MipFilter::BOX, &pool);
+  CompressedImage compressed =
+      compress(image, Texture::block_format(image.channels, type), &pool);
+  bool stored = cache.store(hash, TextureCache::variant(type, true),
+                            compressed, image.channels) &&
+                cache.store(hash, TextureCache::variant(type, false), image);
+  if (!stored) {
+    std::cerr << "ERROR::BAKER::WRITE_FAILED\n" << name << std::endl;
+    return false;
+  }
+  std::cout << name << (paths.size() > 1 ? " (packed)" : "") << " -> "
+            << cache.entry(hash, TextureCache::variant(type, true)).string()
+            << std::endl;
+  return true;
+}
+
+static bool bake_material(const TextureCache &cache, ThreadPool &pool,
+                          const std::string &arg) {
+  std::vector<std::string> parts;
+  std::stringstream stream{arg};
+  for (std::string part; std::getline(stream, part, ',');) {
+    parts.push_back(part);
+  }
+  parts.resize(4);
+  MaterialPaths paths{parts[0], parts[1], parts[2], parts[3]};
+  MaterialLayout layout = material_layout(paths);
+  std::vector<std::string> albedo{paths.diffuse};
+  if (layout.specular_in_alpha) {
+    albedo.push_back(paths.specular);
+  }
+  bool baked = bake(cache, pool, Texture::TextureType::DIFFUSE, albedo);
+  if (layout.scalar_map) {
+    baked = bake(cache, pool, Texture::TextureType::SPECULAR,
+                 {paths.specular, paths.roughness, paths.ao}) &&
+            baked;
+  }
+  return baked;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    std::cerr << "usage: " << argv[0]
+              << " <cache dir> <diffuse|specular|normal> <image> [...]\n"
+              << "       " << argv[0]
+              << " <cache dir> material <diffuse>,<specular>[,<roughness>,<ao>]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  set_flip_vertically_on_load(true);
+  TextureCache cache{argv[1]};
+  ThreadPool pool{};
+
+  Texture::TextureType type{Texture::TextureType::DIFFUSE};
+  bool materials{false};
+  int failures{0};
+  for (int i = 2; i < argc; ++i) {
+    if (std::string{argv[i]} == "material") {
+      materials = true;
+      continue;
+    }
+    if (auto parsed = parse_type(argv[i])) {
+      type = *parsed;
+      materials = false;
+      continue;
+    }
+    if (materials) {
+      failures += bake_material(cache, pool, argv[i]) ? 0 : 1;
+      continue;
+    }
+    MappedFile source{argv[i]};
+    // HDR sources only get the BC6H entry, raw ones are packed at load
+    if (source.valid() && HdrImage::is_hdr(source.bytes())) {
+      HdrImage hdr = HdrImage::load(source.bytes());
+      generate_mips(hdr, MipFilter::BOX, &pool);
+      uint64_t hash = TextureCache::hash(source.bytes());
+      if (hdr.empty() ||
+          !cache.store(hash, TextureCache::variant(type, true),
+                       compress(hdr, &pool), HdrImage::channels)) {
+        std::cerr << "ERROR::BAKER::HDR_FAILED\n" << argv[i] << std::endl;
+        ++failures;
+        continue;
+      }
+      std::cout << argv[i] << " -> "
+                << cache.entry(hash, TextureCache::variant(type, true)).string()
+                << std::endl;
+      continue;
+    }
+    if (!bake(cache, pool, type, {argv[i]})) {
+      ++failures;
+    }
+  }
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+// Decodes every image in a directory with each backend that takes it and
+// prints the average time per decode, at full size and at quarter size (two
+// reductions). The quarter size column includes whatever downsample() has to
+// do after the backend, like decode_image(), so backends that can't scale
+// while decoding are timed doing the full decode plus the reduction.
+//
+//   decode_bench [directory = assets] [runs = 20]
+
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+int main(int argc, char **argv) {
+  std::filesystem::path directory = argc > 1 ? argv[1] : "assets";
+  int runs = argc > 2 ? std::max(1, std::atoi(argv[2])) : 20;
+
+  std::printf("%-24s %-14s %10s %10s %10s\n", "file", "decoder", "size",
+              "full ms", "1/4 ms");
+  for (const auto &file : std::filesystem::directory_iterator(directory)) {
+    if (!file.is_regular_file()) {
+      continue;
+    }
+    MappedFile source{file.path().string()};
+    int width{}, height{};
+    if (!source.valid() || !image_size(source.bytes(), width, height)) {
+      continue;
+    }
+    for (const ImageDecoder *decoder : image_decoders()) {
+      if (!decoder->accepts(source.bytes())) {
+        continue;
+      }
+      double ms[2]{};
+      bool failed{false};
+      for (int reduction : {0, 2}) {
+        auto start = std::chrono::steady_clock::now();
+        for (int run = 0; run < runs && !failed; ++run) {
+          Image image = decoder->decode(source.bytes(), 0, reduction);
+          failed = image.empty();
+          int done{0};
+          while (!failed && done < reduction &&
+                 ((width + (1 << done) - 1) >> done) > image.width) {
+            ++done;
+          }
+          downsample(image, reduction - done, false);
+        }
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        ms[reduction / 2] = elapsed.count() / runs;
+      }
+      std::string size = std::to_string(width) + "x" + std::to_string(height);
+      if (failed) {
+        std::printf("%-24s %-14s %10s %10s\n",
+                    file.path().filename().string().c_str(), decoder->name(),
+                    size.c_str(), "failed");
+        continue;
+      }
+      std::printf("%-24s %-14s %10s %10.2f %10.2f\n",
+                  file.path().filename().string().c_str(), decoder->name(),
+                  size.c_str(), ms[0], ms[1]);
+    }
+  }
+  return EXIT_SUCCESS;
+}